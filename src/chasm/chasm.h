@@ -121,6 +121,52 @@ struct PalBuf__Element
     Uint8 B;
 };
 
+// Wall texture with shading, shared by all columns of segment
+struct TWallSegment
+{
+    const Uint8* Texture;
+    Sint32 RowShift;        // log2 of distance between texels of adjacent rows
+    Sint32 VMask;           // wraps texture row
+    const Uint8* ColorMap;  // 256 entries per shading level
+    bool Transparent;       // texels with color 255 are skipped
+};
+
+// Single screen column of wall
+struct TWallColumn
+{
+    Sint32 Offset;  // texture column offset
+    Sint32 V;       // texture row at Y1, 16.16 fixed point
+    Sint32 DV;      // texture row step per screen row, 16.16 fixed point
+    Sint32 Shade;   // color map offset of shading level
+    Sint16 Y1;      // first screen row
+    Sint16 Y2;      // screen row past the last one
+};
+
+// Floor and ceiling textures are 64x64 tiles, map position has 64 texels per cell
+const int FLOOR_TILE_SIZE  = 64;
+const int FLOOR_TILE_SHIFT = 12;
+
+// Floor and ceiling textures with shading, shared by all spans
+struct TFloorTextures
+{
+    const Uint8* Tiles;      // tiles one after another
+    const Uint16* TileIndex; // tile of texture number
+    const Uint8* FloorMap;   // floor texture number of map cell
+    const Uint8* CellMap;    // ceiling texture number of map cell
+    const Uint8* ColorMap;   // 256 entries per shading level
+};
+
+// Horizontal span of floor or ceiling on single screen row
+struct TFloorSpan
+{
+    Sint32 U;       // map X at screen column zero, 16.16 fixed point in cells
+    Sint32 V;       // map Y at screen column zero, 16.16 fixed point in cells
+    Sint32 DU;      // map X step per screen column, 16.16 fixed point
+    Sint32 DV;      // map Y step per screen column, 16.16 fixed point
+    Sint32 Shade;   // color map offset of shading level
+    Sint16 X1;      // first screen column
+    Sint16 X2;      // screen column past the last one
+};
 
 void GetRealModeIntVector(/*...*/);
 void RealInt60h(/*...*/);
@@ -155,41 +201,67 @@ void WaitServer(/*...*/);
 
 Sint16 MulVectors(/*...*/);
 bool Test2Vectors(/*...*/);
-void VILineL(/*...*/);
+// Times SIMD variants of floor drawing, the fastest ones are used by functions below,
+// must be called on main thread before world view is drawn by worker threads
+void SelectRenderVariants();
+// Opaque wall column, dest points to screen row zero
+void VILineL(Uint8* dest, const int destPitch, const TWallSegment& segment, const TWallColumn& column);
 void VILineL_hi(/*...*/);
-void ShowLine(/*...*/);
-void ShowLine2(/*...*/);
-void ShowGlassLine(/*...*/);
-void ShowGlassLine2(/*...*/);
-void ShowGlassLine4(/*...*/);
-void ShowSegment(/*...*/);
-void ShowSegment2(/*...*/);
-void VIlinePack(/*...*/);
+void ShowLine(Uint8* screen, const int pitch, const int x, const TWallSegment& segment, const TWallColumn& column);
+// Column of double width
+void ShowLine2(Uint8* screen, const int pitch, const int x, const TWallSegment& segment, const TWallColumn& column);
+// Translucent wall column blended with screen, blendTable has 256 entries per shaded texel color,
+// operands are swapped when InversGlass is set
+void ShowGlassLine(Uint8* screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* blendTable);
+// Column of double or quadruple width
+void ShowGlassLine2(Uint8* screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* blendTable);
+void ShowGlassLine4(Uint8* screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* blendTable);
+// Adjacent columns starting from x
+void ShowSegment(Uint8* screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn* const columns, const int count);
+void ShowSegment2(Uint8* screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn* const columns, const int count);
+// Color keyed wall column
+void VIlinePack(Uint8* dest, const int destPitch, const TWallSegment& segment, const TWallColumn& column);
 void VIlineUpPack(/*...*/);
-void Draw_Cell1(/*...*/);
-void Draw_Cell2(/*...*/);
-void Draw_Cell3(/*...*/);
-void CellVHi(/*...*/);
-void Draw_Floor1(/*...*/);
-void Draw_Floor2(/*...*/);
-void Draw_Floor3(/*...*/);
-void FloorVHi(/*...*/);
+// Ceiling span with texel per 1, 2 or 4 screen columns, dest points to screen row
+void Draw_Cell1(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+void Draw_Cell2(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+void Draw_Cell3(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+// Ceiling span with texel per 1 << detail screen columns
+void CellVHi(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span, const int detail);
+// Floor span with texel per 1, 2 or 4 screen columns, dest points to screen row
+void Draw_Floor1(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+void Draw_Floor2(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+void Draw_Floor3(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span);
+// Floor span with texel per 1 << detail screen columns
+void FloorVHi(Uint8* dest, const TFloorTextures& textures, const TFloorSpan& span, const int detail);
 void MovEX(/*...*/);
-void BuildSky(/*...*/);
+// Prepares sky for frame, expanding it again when level or view size changes
+void BuildSky();
+// Sky on view row from view column x1 to x2, dest points to the first view column
+void ShowSky(Uint8* dest, const int row, const int x1, const int x2);
 void BuildFloorCell(/*...*/);
 void DrawCross(/*...*/);
 void ShowValue(/*...*/);
+// Measures wall renderer with row-major and column-major textures
+void BenchmarkWalls();
+// Measures floor renderer and checks SIMD variants against scalar one
+void BenchmarkFloors();
 
 void WhatKey(/*...*/);
 void TimerFM(/*...*/);
 void LoadConfig(const bool original);
 void CalcYMin(/*...*/);
 void StartPaint(/*...*/);
-void UpDateRedShade(/*...*/);
-void UpDateGreenShade(/*...*/);
-void UpdateBlueShade(/*...*/);
+void UpDateRedShade();
+void UpDateGreenShade();
+void UpdateBlueShade();
 void DrawItems(/*...*/);
-void EndPaint(/*...*/);
+void EndPaint();
 bool ExpandWall(/*...*/);
 void ExpandFrame(/*...*/);
 bool ExpandPicture(/*...*/);
@@ -219,14 +291,23 @@ void InsertPlayers(/*...*/);
 void NewGame(/*...*/);
 void MenuStartNet(/*...*/);
 void MenuJoinNet(/*...*/);
-void ExecConsole(/*...*/);
-void ProcessConsole(/*...*/);
+// Runs console command, results are printed to console
+void ExecConsole(const OC::String& command);
+// Frame time budget for quality governor in milliseconds, zero disables it
+void SetQualityTarget(const OC::Double milliseconds);
+// Takes measured frame time, adjusts quality settings if needed
+void UpdateQuality(const OC::Double frameTime);
+// Opens or closes console by ` key, edits and runs command line while it is open
+void ProcessConsole(const SDL_Event& event);
 void LeftRight(/*...*/);
 void LR_Roll(/*...*/);
 void LookForLevel(/*...*/);
 void RemoveMouse(/*...*/);
 void ProcessMenu(/*...*/);
+// Renders world view with worker pool, viewport is split into column strips
 void Build3dScene();
+// Measures scene rendering with different number of threads
+void BenchmarkScene();
 void SwitchToNextWeapon(/*...*/);
 bool WeaponAvail(/*...*/);
 void ChangeWeapon(/*...*/);
@@ -23,6 +23,7 @@
 
 #include "oc/filesystem.h"
 #include "oc/utils.h"
+#include "oc/workers.h"
 
 #include "cspbio.h"
 
@@ -91,9 +92,8 @@ void NextLoading()
     const int w = CSPBIO::LoadPos * CSPBIO::Loading.width() / 150;
     const OC::Rect clipRect(-1, CSPBIO::Loading.height() / 2, w, CSPBIO::Loading.height() / 2);
 
-    // TODO: remove this
-    SDL_Event e; while (1 == SDL_PollEvent(&e)) { }
-    // TODO: remove this
+    // Keep window responsive, events are left in queue for main loop
+    SDL_PumpEvents();
 
     OC::Renderer::instance().draw(CSPBIO::Loading, x, y, clipRect);
     OC::Renderer::instance().present();
@@ -110,7 +110,27 @@ void ExplodeMonster(/*...*/);
 void SetMePain(/*...*/);
 void AddDeadPlayer(/*...*/);
 void ExplodePlayer(/*...*/);
-void ReleaseLevel(/*...*/);
+
+void ReleaseLevel()
+{
+    // Level-scoped bitmaps are about to become invalid, forget them first
+    OC_FOREACH(OC::Bitmap& spryte, CSPBIO::PImPtr)
+    {
+        spryte = OC::Bitmap();
+    }
+
+    CSPBIO::SkyPtr = OC::Bitmap();
+    CSPBIO::Floors = OC::Bitmap();
+
+    StopVisibility();
+
+    for (size_t i = 32; i < CSPBIO::Obj3DInf.size(); ++i)
+    {
+        CSPBIO::Obj3DInf[i] = CSPBIO::TObj3DInfo();
+    }
+
+    OC::BitmapManager::instance().releaseLevel();
+}
 
 namespace
 {
@@ -287,7 +307,7 @@ void ScanMap()
             else if (location.Spr >= 131 && location.Spr <= 226)
             {
                 if ((0 != CSPBIO::CLIENT && 0 != CSPBIO::SERVER || 0 != location.x2)
-                    && !((1 << CSPBIO::Skill) & location.x2))
+                    && !((1 << CSPBIO::Config.Skill) & location.x2))
                 {
                     location.Spr = 0;
                 }
@@ -310,19 +330,963 @@ void ScanMap()
     }
 }
 
+namespace
+{
+
+const int MAP_SIZE = 64;
+const int MAP_CELLS = MAP_SIZE * MAP_SIZE;
+
+// Increment when computation or file layout changes, so stale cache is rebuilt
+const Uint32 VISIBILITY_VERSION = 3;
+const char VISIBILITY_MAGIC[4] = { 'O', 'C', 'V', 'S' };
+
+// Walls except glass ones block sight, items and decorations don't
+CSPBIO::TCellSet SolidCells()
+{
+    CSPBIO::TCellSet result;
+
+    for (int i = 0; i < MAP_CELLS; ++i)
+    {
+        const Uint8 spr = CSPBIO::Map[i].Spr;
+
+        if (spr >= 1 && spr <= CSPBIO::WallMask.size() && 0 != (CSPBIO::WallMask[spr - 1] & 1))
+        {
+            result.set(size_t(i));
+        }
+    }
+
+    return result;
+}
+
+// Line of sight is v = M * u + C, where u is coordinate along the major axis of two cells,
+// both coordinates are relative to the first cell
+struct TLineParams
+{
+    OC::Double M;
+    OC::Double C;
+};
+
+// Convex polygon of lines satisfying all constraints
+typedef std::vector<TLineParams> TLineRegion;
+
+// Keeps part of region where a * M + b * C < d, lines touching the boundary are dropped,
+// as the scene renderer never passes between corners of diagonal walls
+void ClipRegion(const TLineRegion& source, const OC::Double a, const OC::Double b, const OC::Double d,
+    TLineRegion& result)
+{
+    static const OC::Double MARGIN = 1e-7;
+
+    result.clear();
+
+    for (size_t i = 0; i < source.size(); ++i)
+    {
+        const TLineParams& first  = source[i];
+        const TLineParams& second = source[(i + 1) % source.size()];
+
+        const OC::Double firstDistance  = a * first .M + b * first .C - d + MARGIN;
+        const OC::Double secondDistance = a * second.M + b * second.C - d + MARGIN;
+
+        if (firstDistance <= 0.0)
+        {
+            result.push_back(first);
+        }
+
+        if ((firstDistance < 0.0 && secondDistance > 0.0) || (firstDistance > 0.0 && secondDistance < 0.0))
+        {
+            const OC::Double t = firstDistance / (firstDistance - secondDistance);
+
+            TLineParams point;
+            point.M = first.M + (second.M - first.M) * t;
+            point.C = first.C + (second.C - first.C) * t;
+
+            result.push_back(point);
+        }
+    }
+}
+
+// Line passes at or above point (u, v)
+void ClipAbove(TLineRegion& region, TLineRegion& temp, const OC::Double u, const OC::Double v)
+{
+    ClipRegion(region, -u, -1.0, -v, temp);
+    region.swap(temp);
+}
+
+// Line passes at or below point (u, v)
+void ClipBelow(TLineRegion& region, TLineRegion& temp, const OC::Double u, const OC::Double v)
+{
+    ClipRegion(region, u, 1.0, v, temp);
+    region.swap(temp);
+}
+
+// Cell B is visible from cell A when some segment between their points doesn't enter walls,
+// segments touching walls are not counted. Segment from A to B crosses map lines between them
+// and in every line it stays within a run of free cells, so a run is chosen for each line
+// and resulting linear constraints on the segment are checked for a solution.
+// Visible cell is always next to another visible cell closer to A, so only neighbors
+// of visible cells are tested.
+// Each part handles one source cell, sets of other cells are not touched
+class VisibilityBuilder : public OC::ParallelTask
+{
+public:
+    VisibilityBuilder(const CSPBIO::TCellSet& solid, std::vector<CSPBIO::TCellSet>& result);
+
+    virtual void execute(const int part);
+
+private:
+    const CSPBIO::TCellSet& m_solid;
+    std::vector<CSPBIO::TCellSet>& m_result;
+
+    // Runs of free cells, [axis][major][minor] gives the first and past the last cell of run
+    // containing free cell, axis zero is for map lines of constant x
+    Uint8 m_runLow [2][MAP_SIZE][MAP_SIZE];
+    Uint8 m_runHigh[2][MAP_SIZE][MAP_SIZE];
+
+    // Regions of one part, one per map line crossed by segment
+    struct Scratch
+    {
+        std::vector<TLineRegion> Regions;
+        TLineRegion Temp;
+    };
+
+    bool isSolid(const int x, const int y) const
+    {
+        return m_solid.test(size_t(x * MAP_SIZE + y));
+    }
+
+    bool isSolid(const int axis, const int major, const int minor) const
+    {
+        return 0 == axis ? isSolid(major, minor) : isSolid(minor, major);
+    }
+
+    void getEndRun(const int axis, const int major, const int minor, int& low, int& high) const;
+
+    bool isLineClear(const OC::Double fromX, const OC::Double fromY, const OC::Double toX, const OC::Double toY) const;
+    bool findLine(const int axis, const int pu, const int pv, const int du, const int sign, const int k,
+        Scratch& scratch) const;
+    bool canSee(const int ax, const int ay, const int bx, const int by, Scratch& scratch) const;
+};
+
+VisibilityBuilder::VisibilityBuilder(const CSPBIO::TCellSet& solid, std::vector<CSPBIO::TCellSet>& result)
+: m_solid(solid)
+, m_result(result)
+{
+    SDL_zero(m_runLow);
+    SDL_zero(m_runHigh);
+
+    for (int axis = 0; axis < 2; ++axis)
+    {
+        for (int major = 0; major < MAP_SIZE; ++major)
+        {
+            for (int minor = 0; minor < MAP_SIZE; /* EMPTY */)
+            {
+                if (isSolid(axis, major, minor))
+                {
+                    ++minor;
+                    continue;
+                }
+
+                const int low = minor;
+
+                while (minor < MAP_SIZE && !isSolid(axis, major, minor))
+                {
+                    ++minor;
+                }
+
+                for (int i = low; i < minor; ++i)
+                {
+                    m_runLow [axis][major][i] = Uint8(low);
+                    m_runHigh[axis][major][i] = Uint8(minor);
+                }
+            }
+        }
+    }
+}
+
+// Run of cells at the end of segment, the end cell itself may be a wall
+void VisibilityBuilder::getEndRun(const int axis, const int major, const int minor, int& low, int& high) const
+{
+    low = minor;
+
+    while (low > 0 && !isSolid(axis, major, low - 1))
+    {
+        --low;
+    }
+
+    high = minor + 1;
+
+    while (high < MAP_SIZE && !isSolid(axis, major, high))
+    {
+        ++high;
+    }
+}
+
+// Walks cells crossed by segment, the same walk as in scene renderer
+// Cells of both ends are not tested, walls are seen but can't be seen through
+bool VisibilityBuilder::isLineClear(const OC::Double fromX, const OC::Double fromY,
+    const OC::Double toX, const OC::Double toY) const
+{
+    const OC::Double rayX = toX - fromX;
+    const OC::Double rayY = toY - fromY;
+
+    const OC::Double deltaX = 0.0 == rayX ? 1e30 : SDL_fabs(1.0 / rayX);
+    const OC::Double deltaY = 0.0 == rayY ? 1e30 : SDL_fabs(1.0 / rayY);
+
+    int cellX = int(fromX);
+    int cellY = int(fromY);
+
+    const int endX = int(toX);
+    const int endY = int(toY);
+
+    const int stepX = rayX < 0.0 ? -1 : 1;
+    const int stepY = rayY < 0.0 ? -1 : 1;
+
+    OC::Double sideX = (rayX < 0.0 ? fromX - cellX : cellX + 1.0 - fromX) * deltaX;
+    OC::Double sideY = (rayY < 0.0 ? fromY - cellY : cellY + 1.0 - fromY) * deltaY;
+
+    for (;;)
+    {
+        // Position on segment where the next cell is entered, from 0 to 1
+        OC::Double entry;
+
+        if (sideX < sideY)
+        {
+            entry  = sideX;
+            sideX += deltaX;
+            cellX += stepX;
+        }
+        else
+        {
+            entry  = sideY;
+            sideY += deltaY;
+            cellY += stepY;
+        }
+
+        if ((cellX == endX && cellY == endY) || entry >= 1.0)
+        {
+            return true;
+        }
+
+        if (isSolid(cellX, cellY))
+        {
+            return false;
+        }
+    }
+}
+
+// Chooses run of free cells for map line k and all following ones
+// Slope sign is fixed, so line enters map line at one side of the run and leaves it at another
+bool VisibilityBuilder::findLine(const int axis, const int pu, const int pv, const int du, const int sign,
+    const int k, Scratch& scratch) const
+{
+    if (k == du)
+    {
+        return true;
+    }
+
+    const TLineRegion& region = scratch.Regions[k - 1];
+
+    // Range of minor coordinate of all lines of region within map line k
+    OC::Double lowest  =  std::numeric_limits<OC::Double>::max();
+    OC::Double highest = -std::numeric_limits<OC::Double>::max();
+
+    OC_FOREACH(const TLineParams& line, region)
+    {
+        const OC::Double enter = line.M * k + line.C;
+        const OC::Double leave = enter + line.M;
+
+        lowest  = std::min(lowest,  std::min(enter, leave));
+        highest = std::max(highest, std::max(enter, leave));
+    }
+
+    const int major = pu + k;
+    const int first = std::max(int(SDL_floor(lowest )) + pv, 0);
+    const int last  = std::min(int(SDL_floor(highest)) + pv, MAP_SIZE - 1);
+
+    TLineRegion& next = scratch.Regions[k];
+
+    for (int minor = first; minor <= last; /* EMPTY */)
+    {
+        if (isSolid(axis, major, minor))
+        {
+            ++minor;
+            continue;
+        }
+
+        const int low  = m_runLow [axis][major][minor] - pv;
+        const int high = m_runHigh[axis][major][minor] - pv;
+
+        minor = m_runHigh[axis][major][minor];
+
+        next = region;
+
+        if (sign > 0)
+        {
+            ClipAbove(next, scratch.Temp, k,     low );
+            ClipBelow(next, scratch.Temp, k + 1, high);
+        }
+        else
+        {
+            ClipBelow(next, scratch.Temp, k,     high);
+            ClipAbove(next, scratch.Temp, k + 1, low );
+        }
+
+        if (!next.empty() && findLine(axis, pu, pv, du, sign, k + 1, scratch))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool VisibilityBuilder::canSee(const int ax, const int ay, const int bx, const int by, Scratch& scratch) const
+{
+    if (SDL_abs(bx - ax) <= 1 && SDL_abs(by - ay) <= 1)
+    {
+        return true;
+    }
+
+    // Any clear segment proves visibility, most visible cells are found here,
+    // segments join the same points of both cells
+    static const OC::Double POINTS[][2] =
+    {
+        { 0.5,  0.5  },
+        { 0.05, 0.05 },
+        { 0.95, 0.05 },
+        { 0.05, 0.95 },
+        { 0.95, 0.95 },
+    };
+
+    for (size_t i = 0; i < SDL_arraysize(POINTS); ++i)
+    {
+        if (isLineClear(ax + POINTS[i][0], ay + POINTS[i][1], bx + POINTS[i][0], by + POINTS[i][1]))
+        {
+            return true;
+        }
+    }
+
+    // Visibility is symmetric, so cells are ordered along the major axis
+    const int axis = SDL_abs(bx - ax) >= SDL_abs(by - ay) ? 0 : 1;
+
+    int pu = 0 == axis ? ax : ay;
+    int pv = 0 == axis ? ay : ax;
+    int qu = 0 == axis ? bx : by;
+    int qv = 0 == axis ? by : bx;
+
+    if (pu > qu)
+    {
+        std::swap(pu, qu);
+        std::swap(pv, qv);
+    }
+
+    const int du = qu - pu;
+    const int dv = qv - pv;
+
+    int lowP, highP, lowQ, highQ;
+    getEndRun(axis, pu, pv, lowP, highP);
+    getEndRun(axis, qu, qv, lowQ, highQ);
+
+    // Slope of segments between the cells is limited, as they are two or more lines apart
+    const OC::Double maxSlope  = (SDL_abs(dv) + 1.0) / (du - 1) + 1.0;
+    const OC::Double maxOffset = maxSlope + 2.0;
+
+    scratch.Regions.resize(size_t(du));
+
+    for (int sign = -1; sign <= 1; sign += 2)
+    {
+        TLineRegion& region = scratch.Regions[0];
+        region.resize(4);
+
+        region[0].M = sign > 0 ? 0.0 : -maxSlope;
+        region[0].C = -maxOffset;
+        region[1].M = sign > 0 ? maxSlope : 0.0;
+        region[1].C = -maxOffset;
+        region[2].M = region[1].M;
+        region[2].C = maxOffset;
+        region[3].M = region[0].M;
+        region[3].C = maxOffset;
+
+        // Line crosses both cells, corners on both sides of line depend on slope sign
+        if (sign > 0)
+        {
+            ClipAbove(region, scratch.Temp, 1,      0     );
+            ClipBelow(region, scratch.Temp, 0,      1     );
+            ClipAbove(region, scratch.Temp, du + 1, dv    );
+            ClipBelow(region, scratch.Temp, du,     dv + 1);
+        }
+        else
+        {
+            ClipBelow(region, scratch.Temp, 1,      1     );
+            ClipAbove(region, scratch.Temp, 0,      0     );
+            ClipBelow(region, scratch.Temp, du + 1, dv + 1);
+            ClipAbove(region, scratch.Temp, du,     dv    );
+        }
+
+        // Parts of segment in map lines of both cells stay within their runs
+        ClipAbove(region, scratch.Temp, 1,  lowP  - pv);
+        ClipBelow(region, scratch.Temp, 1,  highP - pv);
+        ClipAbove(region, scratch.Temp, du, lowQ  - pv);
+        ClipBelow(region, scratch.Temp, du, highQ - pv);
+
+        if (!region.empty() && findLine(axis, pu, pv, du, sign, 1, scratch))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void VisibilityBuilder::execute(const int part)
+{
+    const int x = part / MAP_SIZE;
+    const int y = part % MAP_SIZE;
+
+    CSPBIO::TCellSet& visible = m_result[part];
+
+    // Camera is not expected inside walls, nothing is culled there
+    if (isSolid(x, y))
+    {
+        visible.set();
+        return;
+    }
+
+    Scratch scratch;
+    std::vector<Uint16> queue(1, Uint16(part));
+
+    // Walls are visible, but sight doesn't continue through them
+    CSPBIO::TCellSet seen;
+    CSPBIO::TCellSet tested;
+
+    seen  .set(queue[0]);
+    tested.set(queue[0]);
+
+    for (size_t i = 0; i < queue.size(); ++i)
+    {
+        const int cx = queue[i] / MAP_SIZE;
+        const int cy = queue[i] % MAP_SIZE;
+
+        for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, MAP_SIZE - 1); ++nx)
+        {
+            for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, MAP_SIZE - 1); ++ny)
+            {
+                const size_t neighbor = size_t(nx * MAP_SIZE + ny);
+
+                if (tested.test(neighbor))
+                {
+                    continue;
+                }
+
+                tested.set(neighbor);
+
+                if (canSee(x, y, nx, ny, scratch))
+                {
+                    seen.set(neighbor);
+
+                    if (!isSolid(nx, ny))
+                    {
+                        queue.push_back(Uint16(neighbor));
+                    }
+                }
+            }
+        }
+    }
+
+    // Entities overlap neighbor cells, so every cell next to visible one is visible too
+    visible.reset();
+
+    for (int cx = 0; cx < MAP_SIZE; ++cx)
+    {
+        for (int cy = 0; cy < MAP_SIZE; ++cy)
+        {
+            if (!seen.test(size_t(cx * MAP_SIZE + cy)))
+            {
+                continue;
+            }
+
+            for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, MAP_SIZE - 1); ++nx)
+            {
+                for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, MAP_SIZE - 1); ++ny)
+                {
+                    visible.set(size_t(nx * MAP_SIZE + ny));
+                }
+            }
+        }
+    }
+}
+
+void ComputeVisibility(const CSPBIO::TCellSet& solid, std::vector<CSPBIO::TCellSet>& result)
+{
+    result.resize(MAP_CELLS);
+
+    VisibilityBuilder builder(solid, result);
+    OC::WorkerPool::instance().run(builder, MAP_CELLS);
+}
+
+// Bit per cell, eight cells per byte
+const size_t CELL_SET_SIZE = MAP_CELLS / 8;
+
+void CellSetToBytes(const CSPBIO::TCellSet& set, Uint8* const bytes)
+{
+    SDL_memset(bytes, 0, CELL_SET_SIZE);
+
+    for (int i = 0; i < MAP_CELLS; ++i)
+    {
+        bytes[i / 8] |= Uint8(set.test(size_t(i)) ? 1 << (i % 8) : 0);
+    }
+}
+
+void CellSetFromBytes(const Uint8* const bytes, CSPBIO::TCellSet& set)
+{
+    for (int i = 0; i < MAP_CELLS; ++i)
+    {
+        set.set(size_t(i), 0 != (bytes[i / 8] & (1 << (i % 8))));
+    }
+}
+
+// Sets of neighbor cells are alike, so every set is stored as difference from the previous one
+// Differences are mostly zero bytes, they are compressed with run length encoding:
+// control byte below 128 is followed by that many plus one literal bytes,
+// otherwise the next byte is repeated control minus 125 times
+void PackCellSets(const std::vector<CSPBIO::TCellSet>& sets, std::vector<Uint8>& packed)
+{
+    std::vector<Uint8> bytes(sets.size() * CELL_SET_SIZE);
+
+    for (size_t i = 0; i < sets.size(); ++i)
+    {
+        CellSetToBytes(sets[i], &bytes[i * CELL_SET_SIZE]);
+    }
+
+    for (size_t i = bytes.size(); i > CELL_SET_SIZE; --i)
+    {
+        bytes[i - 1] ^= bytes[i - 1 - CELL_SET_SIZE];
+    }
+
+    packed.clear();
+
+    for (size_t i = 0; i < bytes.size(); /* EMPTY */)
+    {
+        size_t run = 1;
+
+        while (i + run < bytes.size() && run < 130 && bytes[i + run] == bytes[i])
+        {
+            ++run;
+        }
+
+        if (run >= 3)
+        {
+            packed.push_back(Uint8(run + 125));
+            packed.push_back(bytes[i]);
+
+            i += run;
+            continue;
+        }
+
+        // Literals last until the next run of three equal bytes
+        size_t count = 0;
+
+        while (i + count < bytes.size() && count < 128
+            && !(i + count + 2 < bytes.size()
+                && bytes[i + count] == bytes[i + count + 1] && bytes[i + count] == bytes[i + count + 2]))
+        {
+            ++count;
+        }
+
+        packed.push_back(Uint8(count - 1));
+        packed.insert(packed.end(), bytes.begin() + i, bytes.begin() + i + count);
+
+        i += count;
+    }
+}
+
+bool UnpackCellSets(const std::vector<Uint8>& packed, std::vector<CSPBIO::TCellSet>& sets)
+{
+    std::vector<Uint8> bytes;
+    bytes.reserve(MAP_CELLS * CELL_SET_SIZE);
+
+    for (size_t i = 0; i < packed.size(); /* EMPTY */)
+    {
+        const Uint8 control = packed[i++];
+
+        if (control < 128)
+        {
+            const size_t count = size_t(control) + 1;
+
+            if (i + count > packed.size())
+            {
+                return false;
+            }
+
+            bytes.insert(bytes.end(), packed.begin() + i, packed.begin() + i + count);
+            i += count;
+        }
+        else
+        {
+            if (i >= packed.size())
+            {
+                return false;
+            }
+
+            bytes.insert(bytes.end(), size_t(control) - 125, packed[i++]);
+        }
+    }
+
+    if (MAP_CELLS * CELL_SET_SIZE != bytes.size())
+    {
+        return false;
+    }
+
+    sets.resize(MAP_CELLS);
+
+    for (int i = 0; i < MAP_CELLS; ++i)
+    {
+        Uint8* const set = &bytes[i * CELL_SET_SIZE];
+
+        if (i > 0)
+        {
+            for (size_t j = 0; j < CELL_SET_SIZE; ++j)
+            {
+                set[j] ^= set[j - CELL_SET_SIZE];
+            }
+        }
+
+        CellSetFromBytes(set, sets[i]);
+    }
+
+    return true;
+}
+
+// Cache file holds solid cells it was built for, followed by packed visible sets
+bool LoadVisibility(const OC::Path& path, const CSPBIO::TCellSet& solid, std::vector<CSPBIO::TCellSet>& result)
+{
+    OC::BinaryFile file(path);
+
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    char magic[sizeof VISIBILITY_MAGIC];
+    Uint32 version = 0;
+
+    file.read(magic, sizeof magic);
+    file >> version;
+
+    if (!file || 0 != SDL_memcmp(magic, VISIBILITY_MAGIC, sizeof magic) || VISIBILITY_VERSION != version)
+    {
+        return false;
+    }
+
+    Uint8 solidBytes[CELL_SET_SIZE];
+    CSPBIO::TCellSet cachedSolid;
+    Uint32 packedSize = 0;
+
+    if (std::streamsize(sizeof solidBytes) != file.read(reinterpret_cast<char*>(solidBytes), sizeof solidBytes))
+    {
+        return false;
+    }
+
+    CellSetFromBytes(solidBytes, cachedSolid);
+    file >> packedSize;
+
+    // Packed data can't be larger than unpacked one with a control byte per 128 bytes
+    if (!file || solid != cachedSolid || 0 == packedSize || packedSize > 2 * MAP_CELLS * CELL_SET_SIZE)
+    {
+        return false;
+    }
+
+    std::vector<Uint8> packed(packedSize);
+
+    if (std::streamsize(packedSize) != file.read(reinterpret_cast<char*>(&packed[0]), packedSize))
+    {
+        return false;
+    }
+
+    return UnpackCellSets(packed, result);
+}
+
+void SaveVisibility(const OC::Path& path, const CSPBIO::TCellSet& solid, const std::vector<CSPBIO::TCellSet>& sets)
+{
+    OC::BinaryFile file(path, std::ios::out | std::ios::trunc);
+
+    if (!file.is_open())
+    {
+        SDL_Log("Failed to write visibility cache %s", path.string().c_str());
+        return;
+    }
+
+    Uint8 solidBytes[CELL_SET_SIZE];
+    CellSetToBytes(solid, solidBytes);
+
+    std::vector<Uint8> packed;
+    PackCellSets(sets, packed);
+
+    const Uint32 version    = SDL_SwapLE32(VISIBILITY_VERSION);
+    const Uint32 packedSize = SDL_SwapLE32(Uint32(packed.size()));
+
+    file.write(VISIBILITY_MAGIC, sizeof VISIBILITY_MAGIC);
+    file.write(reinterpret_cast<const char*>(&version), sizeof version);
+    file.write(reinterpret_cast<const char*>(solidBytes), sizeof solidBytes);
+    file.write(reinterpret_cast<const char*>(&packedSize), sizeof packedSize);
+    file.write(reinterpret_cast<const char*>(&packed[0]), std::streamsize(packed.size()));
+}
+
+// Visible cells are computed on background thread, so level starts without waiting for them
+// Until the computation is finished CSPBIO::VisibleCells is empty, so every cell is visible
+class BackgroundVisibility : boost::noncopyable
+{
+public:
+    BackgroundVisibility();
+    ~BackgroundVisibility();
+
+    void start(const CSPBIO::TCellSet& solid, const OC::Path& cachePath);
+    void stop();
+
+    // Passes finished result to CSPBIO::VisibleCells and saves it to cache
+    void update();
+
+private:
+    SDL_Thread*  m_thread;
+    SDL_atomic_t m_done;
+    SDL_atomic_t m_cancel;
+
+    // Owned by background thread while it runs
+    CSPBIO::TCellSet m_solid;
+    std::vector<CSPBIO::TCellSet> m_result;
+
+    OC::Path m_cachePath;
+    Uint64   m_start;
+
+    static int SDLCALL thread(void* data);
+    void run();
+};
+
+BackgroundVisibility::BackgroundVisibility()
+: m_thread(NULL)
+, m_start(0)
+{
+    SDL_AtomicSet(&m_done,   0);
+    SDL_AtomicSet(&m_cancel, 0);
+}
+
+BackgroundVisibility::~BackgroundVisibility()
+{
+    stop();
+}
+
+void BackgroundVisibility::start(const CSPBIO::TCellSet& solid, const OC::Path& cachePath)
+{
+    stop();
+
+    m_solid = solid;
+    m_result.assign(MAP_CELLS, CSPBIO::TCellSet());
+    m_cachePath = cachePath;
+    m_start = SDL_GetPerformanceCounter();
+
+    SDL_AtomicSet(&m_done,   0);
+    SDL_AtomicSet(&m_cancel, 0);
+
+    m_thread = SDL_CreateThread(thread, "Visibility", this);
+
+    if (NULL == m_thread)
+    {
+        OC::DoHaltSDLError("Failed to create visibility thread.");
+    }
+}
+
+void BackgroundVisibility::stop()
+{
+    if (NULL == m_thread)
+    {
+        return;
+    }
+
+    SDL_AtomicSet(&m_cancel, 1);
+    SDL_WaitThread(m_thread, NULL);
+
+    m_thread = NULL;
+    m_result.clear();
+}
+
+void BackgroundVisibility::update()
+{
+    if (NULL == m_thread || 0 == SDL_AtomicGet(&m_done))
+    {
+        return;
+    }
+
+    SDL_WaitThread(m_thread, NULL);
+    m_thread = NULL;
+
+    CSPBIO::VisibleCells.swap(m_result);
+    m_result.clear();
+
+    SDL_Log("Visible cells computed in %.0f ms",
+        (SDL_GetPerformanceCounter() - m_start) * 1000.0 / SDL_GetPerformanceFrequency());
+
+    SaveVisibility(m_cachePath, m_solid, CSPBIO::VisibleCells);
+}
+
+int SDLCALL BackgroundVisibility::thread(void* data)
+{
+    static_cast<BackgroundVisibility*>(data)->run();
+    return 0;
+}
+
+void BackgroundVisibility::run()
+{
+    // Worker pool belongs to scene rendering, so cells are processed here one by one
+    // Low priority leaves CPU to game threads
+    SDL_SetThreadPriority(SDL_THREAD_PRIORITY_LOW);
+
+    VisibilityBuilder builder(m_solid, m_result);
+
+    for (int cell = 0; cell < MAP_CELLS && 0 == SDL_AtomicGet(&m_cancel); ++cell)
+    {
+        builder.execute(cell);
+    }
+
+    SDL_AtomicSet(&m_done, 1);
+}
+
+BackgroundVisibility Visibility;
+
+} // unnamed namespace
+
+void BuildVisibility()
+{
+    StopVisibility();
+
+    const CSPBIO::TCellSet solid = SolidCells();
+
+    // Cache is validated by wall layout, so add-on maps with the same number are told apart
+    const OC::String filename = (OC::Format("level%1$02i.vis") % CSPBIO::LevelN).str();
+    const OC::Path cachePath = OC::FileSystem::instance().userPath(filename);
+
+    if (!LoadVisibility(cachePath, solid, CSPBIO::VisibleCells))
+    {
+        CSPBIO::VisibleCells.clear();
+        Visibility.start(solid, cachePath);
+    }
+}
+
+void UpdateVisibility()
+{
+    Visibility.update();
+}
+
+void StopVisibility()
+{
+    Visibility.stop();
+    CSPBIO::VisibleCells.clear();
+}
+
+void BenchmarkVisibility()
+{
+    static const int THREAD_COUNTS[] = { 1, 4 };
+    static const int ENTITY_COUNT = 1024;
+
+    // Synthetic level, walls are opaque
+    CSPBIO::WallMask.fill(7);
+
+    for (int x = 0; x < MAP_SIZE; ++x)
+    {
+        for (int y = 0; y < MAP_SIZE; ++y)
+        {
+            const bool border = 0 == x || 0 == y || MAP_SIZE - 1 == x || MAP_SIZE - 1 == y;
+
+            CSPBIO::Map[x * MAP_SIZE + y].Spr = border || 0 == rand() % 8 ? Uint8(1 + rand() % 8) : 0;
+        }
+    }
+
+    const CSPBIO::TCellSet solid = SolidCells();
+
+    OC::WorkerPool& pool = OC::WorkerPool::instance();
+    const int poolThreads = pool.threadCount();
+
+    std::vector<CSPBIO::TCellSet> reference;
+
+    SDL_Log("Visibility benchmark, %i CPU cores", SDL_GetCPUCount());
+
+    for (size_t t = 0; t < SDL_arraysize(THREAD_COUNTS); ++t)
+    {
+        pool.setThreadCount(THREAD_COUNTS[t]);
+
+        std::vector<CSPBIO::TCellSet> sets;
+
+        const Uint64 start = SDL_GetPerformanceCounter();
+        ComputeVisibility(solid, sets);
+        const OC::Double seconds = OC::Double(SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+        if (reference.empty())
+        {
+            reference = sets;
+        }
+        else if (reference != sets)
+        {
+            OC::DoHalt(OC::Format("Visible cells computed with %1% threads differ from single threaded ones.")
+                % THREAD_COUNTS[t]);
+        }
+
+        SDL_Log("  %2i threads %8.1f ms", THREAD_COUNTS[t], seconds * 1000.0);
+    }
+
+    pool.setThreadCount(poolThreads);
+
+    // Share of entities expanded from every open cell, entities are placed randomly in open cells
+    std::vector<int> entities;
+
+    while (entities.size() < size_t(ENTITY_COUNT))
+    {
+        const int cell = rand() % MAP_CELLS;
+
+        if (!solid.test(size_t(cell)))
+        {
+            entities.push_back(cell);
+        }
+    }
+
+    size_t visibleCells = 0;
+    size_t expanded = 0;
+    size_t openCells = 0;
+
+    for (int i = 0; i < MAP_CELLS; ++i)
+    {
+        if (solid.test(size_t(i)))
+        {
+            continue;
+        }
+
+        ++openCells;
+        visibleCells += reference[i].count();
+
+        OC_FOREACH(const int entity, entities)
+        {
+            expanded += reference[i].test(size_t(entity)) ? 1 : 0;
+        }
+    }
+
+    SDL_Log("  %.0f of %i cells visible on average, %.1f%% of entities expanded",
+        OC::Double(visibleCells) / openCells, MAP_CELLS, 100.0 * expanded / openCells / ENTITY_COUNT);
+
+    CSPBIO::Map.fill(CSPBIO::TLoc());
+}
+
 void LoadProFile(/*...*/);
 void LoadFloorMap(/*...*/);
 
 void LoadLevel()
 {
+    ReleaseLevel();
+
     StartLoading();
 
-    CSPBIO::FullMap = 0;
-    CSPBIO::takt = 0;
-    CSPBIO::MsTakt = 0;
+    CSPBIO::Config.FullMap = 0;
+    CSPBIO::Sim.takt = 0;
+    CSPBIO::Sim.MsTakt = 0;
     CSPBIO::LCDTrack = 0;
-    CSPBIO::BLevelDef = 320;
-    CSPBIO::FirstTakt = 1;
+    CSPBIO::Sim.BLevelDef = 320;
+    CSPBIO::Sim.FirstTakt = 1;
     CSPBIO::LastBorn = 0;
     NextLoading();
 
@@ -338,20 +1302,21 @@ void LoadLevel()
     NextLoading();
 
     levelFile.seekg(0x4000, std::ios::cur);
-    levelFile >> CSPBIO::LtCount;
-    levelFile.readArray(CSPBIO::Lights, CSPBIO::LtCount);
+    levelFile >> CSPBIO::Sim.LtCount;
+    levelFile.readArray(CSPBIO::Lights, CSPBIO::Sim.LtCount);
     NextLoading();
 
-    CSPBIO::MCount = 0;
-    CSPBIO::SFXSCount = 0;
-    CSPBIO::TotalKills = 0;
-    CSPBIO::TotalKeys = 0;
+    CSPBIO::MonstersList.clear();
+    CSPBIO::Sim.SFXSCount = 0;
+    CSPBIO::Sim.TotalKills = 0;
+    CSPBIO::Sim.TotalKeys = 0;
     CSPBIO::NetPlace.fill(CSPBIO::NetPlaceElement());
     NextLoading();
 
     Uint16 m;
     levelFile >> m;
-    OC::Clamp(Uint16(0), m, Uint16(87));
+
+    Uint16 ignoredMonsters = 0;
 
     for (Uint16 i = 0; i < m; ++i)
     {
@@ -378,7 +1343,7 @@ void LoadLevel()
                 player.RefTime = 0;
                 player.GodTime = 0;
                 
-                CSPBIO::HFi = Uint16(mt.FI << 13);
+                CSPBIO::Sim.HFi = Uint16(mt.FI << 13);
             }
 
             CSPBIO::NetPlaceElement& netPlace = CSPBIO::NetPlace[mt.Mode];
@@ -389,11 +1354,20 @@ void LoadLevel()
         }
         else
         {
-            if ((1 << CSPBIO::Skill) & mt.Mode)
+            if ((1 << CSPBIO::Config.Skill) & mt.Mode)
             {
                 const CSPBIO::TMonsterInfo& monsterInfo = 
                     CSPBIO::MonstersInfo[mt.MType - CSPBIO::FIRST_MONSTER_INDEX];
-                CSPBIO::TMonster& monster = CSPBIO::MonstersList[CSPBIO::MCount];
+                CSPBIO::TMonster* const newMonster = 
+                    CSPBIO::MonstersList.get(CSPBIO::MonstersList.add());
+
+                if (NULL == newMonster)
+                {
+                    ++ignoredMonsters;
+                    continue;
+                }
+
+                CSPBIO::TMonster& monster = *newMonster;
 
                 monster.Mx = mt.mx;
                 monster.My = mt.my;
@@ -406,7 +1380,7 @@ void LoadLevel()
                 monster.Vx = CSPBIO::SinTab[(monster.Fi + 0x100) & 0x3FF] / 32 * speed / 128;
                 monster.Vy = CSPBIO::SinTab[monster.Fi] / 32 * speed / 128;
 
-                monster.Target = -1;
+                monster.Target = CSPBIO::TActorRef();
                 monster.Phase = 2;
                 monster.MMode = 0;
                 monster.MFlags = 0;
@@ -415,23 +1389,27 @@ void LoadLevel()
                 monster.FTime = 0;
                 monster.EVs = 0;
                 monster.EvFi = 0;
-
-                ++CSPBIO::MCount;
             }
         }
     }
 
     OC::FileSystem::instance().checkIO(levelFile);
 
-    if (!CSPBIO::Monsters)
+    if (0 != ignoredMonsters)
+    {
+        SDL_Log("Too many monsters, %u of %u are ignored", unsigned(ignoredMonsters), unsigned(m));
+    }
+
+    if (!CSPBIO::Config.Monsters)
     {
-        CSPBIO::MCount = 0;
+        CSPBIO::MonstersList.clear();
     }
 
     NextLoading();
 
     ScanMap();
     ReloadResources();
+    BuildVisibility();
 
     // TODO...
 }
@@ -467,7 +1445,18 @@ void LoadSpryte(const size_t index)
     }
 
     const OC::String gfxFileName = (OC::Format("level%1$02i/gfx/%2%") % CSPBIO::LevelN % gfxName).str();
-    CSPBIO::PImPtr[index].load(gfxFileName);
+
+    // Raycaster reads walls by columns, so they are stored transposed
+    OC::Bitmap image;
+
+    {
+        const OC::MemoryStats::Scope memoryScope(OC::MemoryStats::CATEGORY_TEMPORARY);
+        image.load(gfxFileName);
+    }
+
+    const OC::MemoryStats::Scope memoryScope(OC::MemoryStats::CATEGORY_LEVEL);
+    CSPBIO::PImPtr[index].createColumnMajor(image, OC::Bitmap::SCOPE_LEVEL);
+    image.release();
 
     // TODO ...
 }
@@ -500,7 +1489,9 @@ OC::String ExtractValue(const OC::String& string)
 void LoadSky(const OC::String& resourceString)
 {
     const OC::String filename = ExtractValue(resourceString);
-    CSPBIO::SkyPtr.load(filename);
+
+    const OC::MemoryStats::Scope memoryScope(OC::MemoryStats::CATEGORY_LEVEL);
+    CSPBIO::SkyPtr.load(filename, OC::Bitmap::SCOPE_LEVEL);
 }
 
 void SetCDTrack(const OC::String& resourceString)
@@ -516,7 +1507,7 @@ void SetDepth(const OC::String& resourceString)
     const OC::String depth = ExtractValue(resourceString);
     const int depthNum = SDL_atoi(depth.c_str());
 
-    CSPBIO::BLevelDef = Sint16(depthNum);
+    CSPBIO::Sim.BLevelDef = Sint16(depthNum);
 }
 
 void ReloadFloors(/*...*/);
@@ -599,26 +1590,26 @@ void LoadEndCamera(/*...*/);
 void InitLevelDefaults()
 {
     CSPBIO::t1 = 4;
-    CSPBIO::GunShift = 64;
-    CSPBIO::ShakeLevel = 0;
-    CSPBIO::LookVz = 0;
-    CSPBIO::WXSize = 64;
-    CSPBIO::MapMode = 0;
-
-    CSPBIO::LastPainTime = 0;
-    CSPBIO::Time = 0;
-
-    CSPBIO::RCount = 0;
-    CSPBIO::BCount = 0;
-    CSPBIO::ExMode = 0;
-    CSPBIO::TCount = 0;
-    CSPBIO::LCount = 0;
-    CSPBIO::SCount = 0;
-    CSPBIO::MnCount = 0;
-    CSPBIO::DCount = 0;
-    CSPBIO::ReCount = 0;
-    CSPBIO::AmCount = 0;
-    CSPBIO::HolCount = 0;
+    CSPBIO::Sim.GunShift = 64;
+    CSPBIO::Sim.ShakeLevel = 0;
+    CSPBIO::Sim.LookVz = 0;
+    CSPBIO::View.WXSize = 64;
+    CSPBIO::Config.MapMode = 0;
+
+    CSPBIO::Sim.LastPainTime = 0;
+    CSPBIO::Sim.Time = 0;
+
+    CSPBIO::RocketList.clear();
+    CSPBIO::BlowsList.clear();
+    CSPBIO::Config.ExMode = 0;
+    CSPBIO::Sim.TCount = 0;
+    CSPBIO::BlowLights.clear();
+    CSPBIO::SepList.clear();
+    CSPBIO::MinesList.clear();
+    CSPBIO::Sim.DCount = 0;
+    CSPBIO::Sim.ReCount = 0;
+    CSPBIO::Sim.AmCount = 0;
+    CSPBIO::HolesList.clear();
 
     CSPBIO::TeleMap.fill(0xFF);
     CSPBIO::Lights.fill(CSPBIO::TLight());
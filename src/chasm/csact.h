@@ -150,9 +150,18 @@ void ExplodeMonster(/*...*/);
 void SetMePain(/*...*/);
 void AddDeadPlayer(/*...*/);
 void ExplodePlayer(/*...*/);
-void ReleaseLevel(/*...*/);
+void ReleaseLevel();
 void ReloadResources();
 void ScanMap();
+// Loads cells visible from every map cell from cache in user directory,
+// or starts their computation on background thread, all cells are visible until it's done
+void BuildVisibility();
+// Takes visible cells when background computation is done, called every frame
+void UpdateVisibility();
+// Cancels background computation, all cells become visible
+void StopVisibility();
+// Measures computation of visible cells and checks it's independent of thread count
+void BenchmarkVisibility();
 void LoadProFile(/*...*/);
 void LoadFloorMap(/*...*/);
 void LoadLevel();
@@ -88,18 +88,21 @@ static void AdjustFaceCoord(Uint16& coord)
     coord = coord * 256 + 128;
 }
 
-void TOHeader::load(const OC::Path& filename)
+void TOHeader::load(const OC::Path& filename, const OC::Bitmap::ScopeType scope)
 {
     OC::BinaryResource file(filename);
 
     load(file);
 
-    TH *= 64;
-    TPtr.resize(TH);
+    TPtr.release();
 
-    file.readArray(TPtr);
+    if (TH > 0)
+    {
+        const OC::MemoryStats::Scope memoryScope(OC::MemoryStats::CATEGORY_MODEL);
+        TPtr.load(file, 64, TH, scope);
+    }
 
-    OC::FileSystem::instance().checkIO(file);
+    TH *= 64;
 
     for (Uint16 i = 0; i < FCount; ++i)
     {
@@ -157,6 +160,31 @@ void TOHeader::load(OC::BinaryInputStream& stream)
 // ===========================================================================
 
 
+TActorRef::TActorRef()
+: Player(-1)
+{
+}
+
+TActorRef TActorRef::player(const Sint16 number)
+{
+    TActorRef result;
+    result.Player = number;
+
+    return result;
+}
+
+TActorRef TActorRef::monster(const OC::PoolHandle& handle)
+{
+    TActorRef result;
+    result.Monster = handle;
+
+    return result;
+}
+
+
+// ===========================================================================
+
+
 TSepPartInfo::TSepPartInfo()
 : ATimeA(0)
 , ATimeB(0)
@@ -406,6 +434,304 @@ TRocketInfo::TRocketInfo()
 // ===========================================================================
 
 
+TViewConst::TViewConst()
+: WinW(0)
+, WinH(0)
+, WinH2u(0)
+, WinH2d(0)
+, WinCY(0)
+, WinSX(0)
+, WinEX(0)
+, WinSY(0)
+, WinEY(0)
+, WinW2(0)
+, WinW2i(0)
+, WallH(0)
+, WallW(0)
+, ObjectW(0)
+, FloorW(0)
+, FloorDiv(0)
+, HXiFF(0)
+, FLeftEnd(0)
+, FRightEnd(0)
+, CLeftEnd(0)
+, CRightEnd(0)
+, FLE160(0)
+, VideoW(0)
+, VideoH(0)
+, VideoBPL(0)
+, VideoEX(0)
+, VideoEY(0)
+, VideoCX(0)
+, VideoCY(0)
+, VPSize(0)
+, Double(0)
+, VideoIsFlat(false)
+, WinB(0)
+, WinB3(0)
+, WinE(0)
+, WinE3(0)
+, WXSize(0)
+, WMapX1(0)
+, WMapX2(0)
+, WMapY1(0)
+, WMapY2(0)
+, WMapX(0)
+, WMapY(0)
+, mpk_x(0)
+, mpk_y(0)
+, mps(0x30)
+, StepMove(0)
+{
+}
+
+
+TRenderState::TRenderState()
+: ica(0)
+, isa(0)
+, ica2(0)
+, isa2(0)
+, ica4(0)
+, isa4(0)
+, HLSt(0)
+, CellV(0)
+, FloorV(0)
+, Sx1(0)
+, Sx2(0)
+, Sx11(0)
+, Sx21(0)
+, SxS(0)
+, tx1(0)
+, tx2(0)
+, ty1(0)
+, ty2(0)
+, _ty1(0)
+, DDark(0)
+, Esl(0)
+, Io0(0)
+, SlY2(0)
+, SLy(0)
+, Hz(0)
+, Hz2(0)
+, DMax(0)
+, Dy(0)
+, DDY(0)
+, oldy(0)
+, _x1(0)
+, _x2(0)
+, _X(0)
+, sl(0)
+, slp(0)
+, ys11(0)
+, ys12(0)
+, ys21(0)
+, ys22(0)
+, ys31(0)
+, ys32(0)
+, sh1(0)
+, sh2(0)
+, HlBr(0)
+, HLxx(0)
+, HLh1(0)
+, Hlh2(0)
+, Hlhr1(0)
+, Hlhr2(0)
+, HLRH(0)
+, HLFh(0)
+, YMin1(0)
+, YMin2(0)
+, Nlines(0)
+, NLines1(0)
+, Cnt(0)
+, FromOfs(0)
+, FullH(0)
+, yf0(0)
+, yf1(0)
+, yf2(0)
+, DNp(0)
+, DNpx(0)
+, DNpy(0)
+, FMapDx(0)
+, FMapDy(0)
+, FShwDx(0)
+, FShwDy(0)
+, TMy(0)
+, FCurMapOfs(0)
+, FMx(0)
+, FMy(0)
+, v1x(0)
+, v1y(0)
+, v2x(0)
+, v2y(0)
+, nx(0)
+, ny(0)
+, HS(0)
+, Hx(0)
+, Hy(0)
+, HMx(0)
+, HMy(0)
+, ehx(0)
+, ehy(0)
+, ehz(0)
+, DShift(0)
+, Dir(0)
+, lvz(0)
+, hvz(0)
+, EDI0(0)
+, Edi1(0)
+, mEDX(0)
+, RSize(0)
+, rrx(0)
+, rry(0)
+, nhxi(0)
+, nhyi(0)
+, aLwx(0)
+, aLWy(0)
+, DSh(0)
+, LWx(0)
+, LWy(0)
+, Rx(0)
+, Ry(0)
+, R(0)
+, SkyVisible(false)
+, ViewCell(0)
+{
+}
+
+
+TSimState::TSimState()
+: takt(0)
+, MsTakt(0)
+, Time(0)
+, Time0(0)
+, ZTime(0)
+, RealTime(0)
+, CurTime(0)
+, SecCounter(0)
+, NewSecond(false)
+, FirstTakt(false)
+, Paused(false)
+, IamDead(false)
+, DCount(0)
+, LtCount(0)
+, TCount(0)
+, AmCount(0)
+, ReCount(0)
+, SFXSCount(0)
+, RShadeDir(0)
+, RShadeLev(0)
+, LastRShadeLev(0)
+, GShadeDir(0)
+, GShadeLev(0)
+, LastGShadeLev(0)
+, BShadeDir(0)
+, BShadeLev(0)
+, LastBShadeLev(0)
+, LandZ(0)
+, CeilZ(0)
+, HFi(0)
+, EHFi(0)
+, HRv(0)
+, HksFlags(0)
+, LookVz(0)
+, _LookVz(0)
+, ShakeLevel(0)
+, GunDx(0)
+, GunDy(0)
+, WpnShx(0)
+, WpnShy(0)
+, WeaponActive(false)
+, WeaponFTime(0)
+, WeaponPhase(0)
+, MTime(0)
+, LastGunNumber(0)
+, GunShift(0)
+, MyDeath(0)
+, LastPainTime(0)
+, LastMouseTime(0)
+, MSRND(0)
+, Times10Sum(0)
+, _Times10Sum(0)
+, Frames10Count(0)
+, TotalKills(0)
+, TotalKeys(0)
+, EndDelay(0)
+, BLevelDef(320)
+, BLevel0(0)
+, BLevelW(0)
+, BlevelC(0)
+, BLevelF(0)
+{
+}
+
+
+TConfigState::TConfigState()
+: MenuCode(4)
+, MenuMode(0)
+, MenuMainY(0)
+, MenuOn(false)
+, LoadSaveY(0)
+, OptionsY(0)
+, CSCopy(0)
+, Console(false)
+, ConsY(0)
+, ConsDY(0)
+, ConsMode(0)
+, ConsMainY(0)
+, ConsMenu(0)
+, HistCnt(4)
+, CurHist(5)
+, InfoPage(true)
+, TabMode(false)
+, MapMode(false)
+, FullMap(false)
+, TimeInd(false)
+, Ranking(false)
+, ExMode(false)
+, Skill(1)
+, RespawnTime(8400)
+, Monsters(true)
+, Animation(true)
+, ClipMode(false)
+, Slow(false)
+, Spline(true)
+, Chojin(false)
+, SafeLoad(false)
+, EpisodeReset(false)
+, AlwaysRun(false)
+, ReverseMouse(false)
+, Cocpit(true)
+, MSsens(0)
+, _FrontOn(0)
+, _BackOn(0)
+, _LeftOn(0)
+, _RightOn(0)
+, _SLeftOn(0)
+, _SRightOn(0)
+, _JumpOn(0)
+, _FireOn(0)
+, _ChangOn(0)
+, _StrafeOn(0)
+, _SpeedUpOn(0)
+, _MLookOn(0)
+, _MLookT(0)
+, _ViewUpOn(0)
+, _ViewCntrOn(0)
+, _ViewDnOn(0)
+, Ms1ID(0)
+, Ms2ID(0)
+, ms3id(0)
+, MLookOn(false)
+, JoyStick(false)
+, MouseD(false)
+, SelfNick("UNKNOWN")
+, SelfColor(1)
+{
+}
+
+// ===========================================================================
+
+
 Uint16 QPifagorA32(/*...*/);
 void getmousestate(/*...*/);
 Sint16 GetJoyX(/*...*/);
@@ -418,8 +744,23 @@ void movsD(/*...*/);
 void settimer(/*...*/);
 void Beep(/*...*/);
 bool FExistFile(/*...*/);
-void FadeOut(/*...*/);
-void FadeIn(/*...*/);
+namespace
+{
+
+// Duration of screen fading, milliseconds
+const Uint32 FADE_DURATION = 250;
+
+} // unnamed namespace
+
+void FadeOut()
+{
+    OC::Renderer::instance().fade(0, FADE_DURATION);
+}
+
+void FadeIn()
+{
+    OC::Renderer::instance().fade(64, FADE_DURATION);
+}
 
 void CalcDir(/*...*/);
 Sint16 Max(/*...*/);
@@ -465,7 +806,7 @@ void LoadAnimation(const OC::String& filename, const Uint16 modelVertexCount, Po
     OC::FileSystem::instance().checkIO(animationFile);
 }
 
-void LoadPOH(const OC::String& filename, TOHeader& model)
+void LoadPOH(const OC::String& filename, TOHeader& model, const OC::Bitmap::ScopeType scope)
 {
     if (filename.empty())
     {
@@ -475,7 +816,7 @@ void LoadPOH(const OC::String& filename, TOHeader& model)
     const OC::Path modelPath = filename.size() > 12  // TODO: better check
         ? filename
         : "models/" + filename;
-    model.load(modelPath);
+    model.load(modelPath, scope);
 
     // Most of LoadPOH() code moved to TOHeader::load()
 }
@@ -804,7 +1145,73 @@ Uint16 CalcStringLen(const OC::String& string)
     return result;
 }
 
-void ReInitViewConst(/*...*/);
+void ReInitViewConst(const Uint16 width, const Uint16 height)
+{
+    SDL_assert(width  >= MIN_VIDEO_WIDTH  && width  <= MAX_VIDEO_WIDTH );
+    SDL_assert(height >= MIN_VIDEO_HEIGHT && height <= MAX_VIDEO_HEIGHT);
+
+    View.VideoW   = width;
+    View.VideoH   = height;
+    View.VideoBPL = width;
+
+    View.VideoEX  = width  - 1;
+    View.VideoEY  = height - 1;
+
+    View.VideoCX  = width  / 2;
+    View.VideoCY  = height / 2;
+
+    View.VPSize   = Sint32(View.VideoBPL) * height;
+
+    // Number of 32 pixels wide floor spans
+    View.FloorDiv = (width + 16) / 32;
+
+    // Full screen view window
+    View.WinW   = width;
+    View.WinH   = height;
+    View.WinSX  = 0;
+    View.WinEX  = View.VideoEX;
+    View.WinSY  = 0;
+    View.WinEY  = View.VideoEY;
+    View.WinW2  = width / 2;
+    View.WinW2i = Sint16(width / 2);
+    View.WinCY  = height / 2;
+
+    // Row offsets, with one extra row for end of screen
+    MulSW.resize(height + 1);
+
+    for (size_t i = 0; i < MulSW.size(); ++i)
+    {
+        MulSW[i] = Sint32(View.VideoBPL * i);
+    }
+
+    // Eye is in the middle between floor and ceiling, walls one cell high are WinW2 pixels high at unit distance
+    FloorDist.resize(height);
+
+    for (size_t i = 0; i < FloorDist.size(); ++i)
+    {
+        const OC::Double rows = SDL_fabs(i + 0.5 - View.WinCY);
+        FloorDist[i] = Sint32(std::min(View.WinW2 / 2.0 / rows * 65536.0, OC::Double(std::numeric_limits<Sint32>::max())));
+    }
+
+    // Column buffers
+    Coverage.resize(width);
+}
+
+bool IsVisibleFromView(const Sint16 x, const Sint16 y)
+{
+    // Map coordinates have 256 units per cell
+    const int cellX = x >> 8;
+    const int cellY = y >> 8;
+
+    // Everything is visible until sets are built, and so is everything outside of map
+    if (VisibleCells.empty() || cellX < 0 || cellX >= 64 || cellY < 0 || cellY >= 64)
+    {
+        return true;
+    }
+
+    return VisibleCells[Render.ViewCell].test(size_t(cellX * 64 + cellY));
+}
+
 void AddBlowLight(/*...*/);
 void _AddBlowLight(/*...*/);
 void AddBlow(/*...*/);
@@ -834,6 +1241,11 @@ void PutConsMessage3(const OC::String& message)
     PutConsMessage(message); // TODO ...
 }
 
+TViewConst   View;
+TRenderState Render;
+TSimState    Sim;
+TConfigState Config;
+
 Uint16 ServerVersion;
 Sint32 Long1;
 Uint8 LB;
@@ -876,15 +1288,15 @@ boost::array<OC::Bitmap, 120> PImPtr;
 boost::array<Uint8, 120> WallMask;
 boost::array<TObjBMPInfo, 4> ObjBMPInf;
 boost::array<TObj3DInfo, 96> Obj3DInf;
-Uint16 LinesH1[847];
-Uint16 LinesH2[847];
-TLinesBuf LinesBUF;
-THoleItem* HolesList;
+OC::CoverageBuffer Coverage;
+std::vector<THoleItem> HolesList;
 boost::array<Uint8, 120> SpryteUsed;
 boost::array<Uint16, 201> Mul320;
-boost::array<Sint32, 701> MulSW;
+std::vector<Sint32> MulSW;
+std::vector<Sint32> FloorDist;
 boost::array<Sint16, 1024> SinTab;
 boost::array<TLoc, 4096> Map;
+std::vector<TCellSet> VisibleCells;
 std::list<OC::String> ConsHistory;
 boost::array<Uint8, 4096> VMask;
 boost::array<Uint8, 4096> Flags;
@@ -895,13 +1307,27 @@ Uint8* FloorZHi;
 Uint8* FloorZLo;
 EndCamera__Type EndCamera;
 boost::array<TEvent, 16> EventsList;
-TFrame* FramesList;
-TBlow* BlowsList;
-TMonster MonstersList[90];
-TRocket RocketList[64];
-TSepPart SepList[32];
-TMine MinesList[16];
-TBlowLight BlowLights[32];
+
+std::vector<TFrame> FramesList;
+
+std::vector<TBlow> BlowsList;
+// Original limits were 90 monsters, 64 rockets, 32 parts, 16 mines and 32 lights
+// Pools grow on demand up to these much higher defaults, see SetEntityLimit()
+OC::Pool<TMonster> MonstersList(4096);
+OC::Pool<TRocket> RocketList(4096);
+OC::Pool<TSepPart> SepList(4096);
+OC::Pool<TMine> MinesList(1024);
+OC::Pool<TBlowLight> BlowLights(1024);
+
+void SetEntityLimit(const size_t limit)
+{
+    MonstersList.setMaxSize(limit);
+    RocketList.setMaxSize(limit);
+    SepList.setMaxSize(limit);
+    MinesList.setMaxSize(limit);
+    BlowLights.setMaxSize(limit);
+}
+
 boost::array<TMonsterInfo, 23> MonstersInfo;
 boost::array<TRocketInfo, 32> RocketsInfo;
 boost::array<TSepPartInfo, 90> SepPartInfo;
@@ -924,6 +1350,7 @@ OC::Bitmap Status;
 OC::Bitmap Loading;
 OC::Bitmap VesaTiler;
 OC::Bitmap SkyPtr;
+OC::Bitmap Floors;
 
 RGBTable RGBTab25;
 RGBTable RGBTab60;
@@ -931,103 +1358,26 @@ RGBTable RGBTab60;
 Uint16 LoadPos;
 OC::Real ca;
 OC::Real sa;
-Sint16 RShadeDir;
-Sint16 RShadeLev;
-Sint16 LastRShadeLev;
-Sint16 BShadeDir;
-Sint16 BShadeLev;
-Sint16 LastBShadeLev;
-Sint16 GShadeDir;
-Sint16 GShadeLev;
-Sint16 LastGShadeLev;
-Uint16 MenuCode = 4;
-Uint16 CSCopy;
-Uint16 LoadSaveY = 0;
-Uint16 OptionsY = 0;
 Uint8 NetMode;
 Uint8 TeamMode;
 Uint8 SHRC;
 TMonster Ms;
-Sint16 Skill = 1;
 Sint16 MyNetN = 0;
 Sint16 bpx;
 Sint16 bpy;
 OC::Bitmap ConsolePtr;
 ConsoleText ConsoleComm(7);
-Sint16 ConsY = 0;
-Sint16 ConsDY = 0;
-Sint16 ConsMode;
-Sint16 ConsMainY = 0;
-Sint16 ConsMenu;
-Sint16 HistCnt = 4;
-Sint16 CurHist = 5;
-Sint16 MenuMode;
-Sint16 MenuMainY;
-Uint8 MSsens;
 Sint16 DisplaySett[3];
-Sint16 LandZ;
-Sint16 CeilZ;
-Sint16 EndDelay;
-Uint16 Hz;
-Uint16 Hz2;
-Uint16 DMax;
-Uint16 Dy;
-Uint16 DDY;
-Uint16 oldy;
-Uint16 _x1;
-Uint16 _x2;
-Uint16 _X;
-Uint16 sl;
-Uint16 slp;
 Uint16 t1;
-Uint16 Times10Sum;
-Uint16 _Times10Sum;
-Uint16 Frames10Count;
-Uint16 CurTime;
-Uint16 LastGunNumber;
-Uint16 GunShift;
-Uint16 RespawnTime = 8400;
-Uint16 ys31;
-Uint16 ys32;
-Uint16 ys11;
-Uint16 ys12;
-Uint16 ys21;
-Uint16 ys22;
-Uint16 sh1;
-Uint16 sh2;
 Uint16 mysy;
 Uint16 ObjectsLoaded;
 Uint16 WeaponsCount;
-Uint16 MCount;
-Uint16 TotalKills;
-Uint16 TotalKeys;
-Uint16 RCount;
-Uint16 BCount;
-Uint16 DCount;
-Uint16 FCount;
-Uint16 LCount;
-Uint16 LtCount;
-Uint16 SCount;
-Uint16 TCount;
-Uint16 MnCount;
-Uint16 AmCount;
-Uint16 ReCount;
-Uint16 HolCount;
-Uint16 SFXSCount;
 Uint16 InfoLen;
 Uint16 Di0;
 Uint16 Dx0;
 Uint16 Recsize;
-Uint16 MTime;
-Uint16 WeaponFTime;
-Uint16 WeaponPhase;
 Uint16 j;
 Uint16 w;
-Uint16 BLevelDef = 320;
-Uint16 BLevel0;
-Uint16 BLevelW;
-Uint16 BlevelC;
-Uint16 BLevelF;
 Uint16 VgaSeg;
 Uint16 RGBSeg;
 Uint16 PSeg;
@@ -1037,228 +1387,35 @@ Uint16 ImSeg;
 Uint16 ImOfs;
 Uint16 Ims;
 Uint16 ImSegS;
-Uint16 MyDeath;
 Uint16 ObjectX;
 Uint16 ObjectY;
 Uint16 ObjSeg;
-Uint16 HlBr;
-Uint16 HLxx;
-Uint16 HLh1;
-Uint16 Hlh2;
-Uint16 Hlhr1;
-Uint16 Hlhr2;
-Uint16 HLRH;
-Uint16 HLFh;
-Uint16 YMin1;
-Uint16 YMin2;
-Uint16 Nlines;
-Uint16 NLines1;
-Uint16 takt;
-Uint16 MsTakt;
 Uint16 b0;
 Uint16 b1;
-bool WeaponActive;
-Sint32 CellV;
-Sint32 FloorV;
-Sint32 HLSt;
-Sint16 WXSize;
-Sint16 isa;
-Sint16 ica;
-Sint16 ica2;
-Sint16 isa2;
-Sint16 isa4;
-Sint16 ica4;
-Sint16 SxS;
-Sint16 Sx11;
-Sint16 Sx21;
-Sint16 Sx1;
-Sint16 Sx2;
-Sint16 DShift;
-Sint16 Dir;
-Sint16 WpnShx;
-Sint16 WpnShy;
-Sint16 lvz;
-Sint16 hvz;
-Sint16 GunDx;
-Sint16 GunDy;
-Sint16 ShakeLevel;
-Sint16 LookVz;
-Sint16 _LookVz;
-Sint16 v1x;
-Sint16 v1y;
-Sint16 v2x;
-Sint16 v2y;
-Sint16 nx;
-Sint16 ny;
-Sint16 HS;
-Sint16 Hx;
-Sint16 Hy;
-Sint16 HMx;
-Sint16 HMy;
-Sint16 ehx;
-Sint16 ehy;
-Sint16 ehz;
 Sint16 mi;
 Sint16 MapR;
 Sint16 LevelN = 1;
 Sint16 ox;
-Sint16 HRv;
-Uint16 HksFlags;
-Uint16 HFi;
-Uint16 EHFi;
-bool FirstTakt;
-bool InfoPage = true;
 bool NextL;
 bool SERVER = false;
 bool CLIENT = false;
-bool Paused;
-bool Monsters = true;
-bool Animation = true;
-bool TimeInd;
-bool FullMap;
 bool EndOfTheGame;
-bool ClipMode = false;
-bool IamDead;
-bool Slow = false;
-bool Spline = true;
-bool Ranking;
-bool NewSecond;
 bool OAnimate;
-bool MapMode;
-bool ExMode;
-bool Chojin = false;
-bool TabMode;
-bool SafeLoad;
-bool EpisodeReset;
-bool AlwaysRun;
-bool ReverseMouse;
-bool SkyVisible;
-bool MenuOn;
-bool Console = false;
-bool Cocpit = true;
 bool GameActive;
-Uint8 SecCounter;
 void (*TimerInt)() = NULL;
 void (*KbdInt)() = NULL;
-Sint32 EDI0;
-Sint32 Edi1;
-Sint32 mEDX;
 Sint32 Ll;
-Sint32 Time0;
-Sint32 Time;
-Sint32 ZTime;
 Sint32 k;
-Sint32 RealTime;
-Sint32 LastMouseTime;
-Sint32 LastPainTime;
 Sint32 StartUpRandSeed = Sint32(time(NULL));
-Sint32 MSRND;
 TLoc L;
-bool VideoIsFlat;
-Uint16 WinW;
-Uint16 WinW2;
-Uint16 WinSX;
-Uint16 WinEX;
-Uint16 WinSY;
-Uint16 WinEY;
-Uint16 WinH;
-Uint16 WinH2u;
-Uint16 WinH2d;
-Uint16 WinCY;
-Uint16 WallH;
-Uint16 WallW;
-Uint16 ObjectW;
-Uint16 WinB;
-Uint16 WinB3;
-Uint16 WinE;
-Uint16 WinE3;
-Sint16 WMapX1;
-Sint16 WMapX2;
-Sint16 WMapY1;
-Sint16 WMapY2;
-Sint16 WMapX;
-Sint16 WMapY;
-Sint16 mpk_x;
-Sint16 mpk_y;
-Sint16 mps = 0x30;
-Sint16 WinW2i;
-Sint16 StepMove;
-Sint16 FLeftEnd;
-Sint16 FRightEnd;
-Sint16 CLeftEnd;
-Sint16 CRightEnd;
-Sint16 FLE160;
-Sint16 DNpy;
-Sint16 DNpx;
-Sint16 FMapDx;
-Sint16 FMapDy;
-Sint16 FShwDx;
-Sint16 FShwDy;
-Uint16 HXiFF;
-Uint16 FloorW;
-Uint16 FloorDiv;
-Uint16 TMy;
-Uint16 DNp;
-Uint16 FCurMapOfs;
-Uint16 FMx;
-Uint16 FMy;
-Sint32 Esl;
-Sint32 Io0;
-Sint32 SlY2;
-Sint32 SLy;
-Sint16 tx1;
-Sint16 tx2;
-Sint16 ty1;
-Sint16 ty2;
-Sint16 _ty1;
-Sint16 DDark;
 Uint16 WShadowOfs;
 Uint16 CMPOfs;
 Uint16 XOfsMask;
-Uint16 Cnt;
-Uint16 FromOfs;
-Uint16 FullH;
-Uint16 yf0;
-Uint16 yf1;
-Uint16 yf2;
 Uint16 ScrollK;
-Uint8 Double;
-Sint16 RSize;
-Sint16 rrx;
-Sint16 rry;
-Sint16 nhxi;
-Sint16 nhyi;
-Sint16 aLwx;
-Sint16 aLWy;
-Sint16 DSh;
-Sint16 LWx;
-Sint16 LWy;
-Sint16 Rx;
-Sint16 Ry;
-Sint16 R;
 bool KeysState[128];
 Uint8 KBDBuf[16];
 Uint16 KBDBufCnt;
 Uint8 KeysID[16];
-Uint8 _FrontOn;
-Uint8 _BackOn;
-Uint8 _LeftOn;
-Uint8 _RightOn;
-Uint8 _SLeftOn;
-Uint8 _SRightOn;
-Uint8 _JumpOn;
-Uint8 _FireOn;
-Uint8 _ChangOn;
-Uint8 _StrafeOn;
-Uint8 _SpeedUpOn;
-Uint8 _MLookOn;
-Uint8 _MLookT;
-Uint8 _ViewUpOn;
-Uint8 _ViewCntrOn;
-Uint8 _ViewDnOn;
-Uint8 Ms1ID;
-Uint8 Ms2ID;
-Uint8 ms3id;
 bool kbViewUp;
 bool kbViewDn;
 bool kbViewCntr;
@@ -1277,7 +1434,6 @@ Sint16 JoyMnX;
 Sint16 JoyMnY;
 Sint16 JoyMxX;
 Sint16 JoyMxY;
-bool JoyStick = false;
 bool JoyKeyA;
 bool JoyKeyB;
 Sint16 MsX;
@@ -1291,11 +1447,9 @@ Sint16 MsRv;
 Sint16 MsVV;
 Sint16 Msvvi;
 Sint16 msrvi;
-bool MouseD;
 bool MsKeyA;
 bool MsKeyB;
 bool MsKeyC;
-bool MLookOn;
 bool RecordDemo = false;
 bool PlayDemo = true;
 bool IPXPresent;
@@ -1308,8 +1462,6 @@ Uint8 NGPort;
 Uint8 NGBaud;
 Uint8 NGColor;
 OC::String::value_type NGNick[9];
-OC::String SelfNick = "UNKNOWN";
-Uint8 SelfColor = 1;
 TInfo_Struct* PInfoStruct;
 bool MSCDEX;
 Sint16 LCDTrack;
@@ -1745,7 +1897,11 @@ void Load3DObject(OC::TextResource& resource, TObj3DInfo& object, const Load3DOb
         }
     }
 
-    LoadPOH(modelFileName, object.POH);
+    const OC::Bitmap::ScopeType scope = LOAD_3D_OBJECT_LEVEL_RESOURCE == mode
+        ? OC::Bitmap::SCOPE_LEVEL
+        : OC::Bitmap::SCOPE_GLOBAL;
+
+    LoadPOH(modelFileName, object.POH, scope);
     LoadAnimation(animationFileName, object.POH.VCount, object.PAni, object.ATime);
 
     ScanLoHi(object.LoZ, object.HiZ, object.POH);
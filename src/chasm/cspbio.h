@@ -22,7 +22,12 @@
 #ifndef OPENCHASM_CSPBIO_H_INCLUDED
 #define OPENCHASM_CSPBIO_H_INCLUDED
 
+#include "oc/coverage.h"
 #include "oc/graphics.h"
+#include "oc/memory.h"
+#include "oc/pool.h"
+
+#include <bitset>
 
 namespace OC
 {
@@ -83,7 +88,24 @@ struct TPoint3di
     void load(OC::BinaryInputStream& stream);
 };
 
-typedef std::vector<TPoint3di> Point3DList;
+typedef OC::TrackedAllocator<TPoint3di, OC::MemoryStats::CATEGORY_ANIMATION> Point3DAllocator;
+typedef std::vector<TPoint3di, Point3DAllocator> Point3DList;
+
+// Reference to player or monster, used for targets and owners
+// Monster is referenced by pool handle, so the reference becomes invalid
+// when the monster is removed from the pool
+struct TActorRef
+{
+    Sint16 Player; // player number or -1
+    OC::PoolHandle Monster;
+
+    TActorRef();
+
+    static TActorRef player(const Sint16 number);
+    static TActorRef monster(const OC::PoolHandle& handle);
+
+    bool isPlayer() const { return Player >= 0; }
+};
 
 struct TPoint2D
 {
@@ -109,11 +131,11 @@ struct TOHeader
     Uint16 FCount;
     
     Uint16 TH;
-    std::vector<Uint8> TPtr;
+    OC::Bitmap TPtr; // 64 pixels wide texture
 
     TOHeader();
 
-    void load(const OC::Path& filename);
+    void load(const OC::Path& filename, const OC::Bitmap::ScopeType scope = OC::Bitmap::SCOPE_GLOBAL);
     void load(OC::BinaryInputStream& stream);
 };
 
@@ -303,7 +325,8 @@ struct TPicPack
     Uint16 NFrames;
     boost::array<Uint16, 24> FrameOfs;
 
-    std::vector<Uint8> PData;
+    typedef OC::TrackedAllocator<Uint8, OC::MemoryStats::CATEGORY_PICTURE_PACK> DataAllocator;
+    std::vector<Uint8, DataAllocator> PData;
 
     TPicPack();
 };
@@ -354,15 +377,6 @@ struct FIB
     char Buffer[128];
 };
 
-struct TLinesBuf
-{
-    boost::array<Uint16, 1024> LinesS;
-    boost::array<Uint16, 1024> LinesO;
-    boost::array<Uint16, 1024> LinesFH1;
-    boost::array<Uint16, 1024> LinesFH2;
-    boost::array<Uint8,  1024> LinesB;
-};
-
 struct MessageRec__Element
 {
     OC::String::value_type Line[61];
@@ -382,8 +396,8 @@ struct TRocket
     Sint16 vx;
     Sint16 vy;
     Sint16 vz;
-    Sint16 Target;
-    Sint16 Owner;
+    TActorRef Target;
+    TActorRef Owner;
 };
 
 struct TInfo_Struct
@@ -485,7 +499,7 @@ struct TMonster
     Sint16 Vx;
     Sint16 Vy;
     Sint16 LifeMeter;
-    Sint16 Target;
+    TActorRef Target;
     Sint16 LPx;
     Sint16 LPy;
     Sint16 EvFi;
@@ -634,7 +648,7 @@ struct TMine
     Sint16 mny;
     Sint16 mntime;
     Sint16 mnz;
-    Sint16 MOwner;
+    TActorRef MOwner;
 };
 
 struct ModeInfoBlock
@@ -781,6 +795,8 @@ void InitVESAMonitor(/*...*/);
 void VESA_TileScreen(/*...*/);
 void vesa_DrawKey(/*...*/);
 void ReDrawGround();
+// Replaces Init320x200() and Init_HiMode(), can be called at any time
+void SetVideoMode(const Uint16 width, const Uint16 height);
 
 Uint16 QPifagorA32(/*...*/);
 void getmousestate(/*...*/);
@@ -794,8 +810,9 @@ void movsD(/*...*/);
 void settimer(/*...*/);
 void Beep(/*...*/);
 bool FExistFile(/*...*/);
-void FadeOut(/*...*/);
-void FadeIn(/*...*/);
+// Both start fading and return immediately
+void FadeOut();
+void FadeIn();
 
 void CalcDir(/*...*/);
 Sint16 Max(/*...*/);
@@ -803,7 +820,8 @@ Sint16 Min(/*...*/);
 Sint8 Sgn(/*...*/);
 void SetCurPicTo(/*...*/);
 void LoadAnimation(const OC::String& filename, const Uint16 modelVertexCount, Point3DList& vertices, Uint16& time);
-void LoadPOH(const OC::String& filename, TOHeader& model);
+void LoadPOH(const OC::String& filename, TOHeader& model,
+    const OC::Bitmap::ScopeType scope = OC::Bitmap::SCOPE_GLOBAL);
 void ScanLoHi(Sint16& loZ, Sint16& hiZ, const TOHeader& model);
 void ScanLowHigh(/*...*/);
 void InitCaracter(const size_t monsterNumber);
@@ -831,7 +849,11 @@ void DrawBrKey(/*...*/);
 void BrightBar(/*...*/);
 void ShowMap(/*...*/);
 Uint16 CalcStringLen(const OC::String& string);
-void ReInitViewConst(/*...*/);
+// Recalculates view constants and resolution dependent tables
+void ReInitViewConst(const Uint16 width, const Uint16 height);
+// Checks whether map position is in cell visible from view cell,
+// entities failing this test are not expanded for rendering
+bool IsVisibleFromView(const Sint16 x, const Sint16 y);
 void AddBlowLight(/*...*/);
 void _AddBlowLight(/*...*/);
 void AddBlow(/*...*/);
@@ -843,6 +865,373 @@ void PutConsMessage(const OC::String& message);
 void PutConsMessage2(const OC::String& message);
 void PutConsMessage3(const OC::String& message);
 
+// ===========================================================================
+
+
+// Supported range of video modes
+const Uint16 MIN_VIDEO_WIDTH  = 320;
+const Uint16 MIN_VIDEO_HEIGHT = 200;
+const Uint16 MAX_VIDEO_WIDTH  = 3840;
+const Uint16 MAX_VIDEO_HEIGHT = 2160;
+
+// View constants, recalculated on video mode or view window change only
+// Read by every column of every frame
+struct TViewConst
+{
+    // Screen window
+    Uint16 WinW;
+    Uint16 WinH;
+    Uint16 WinH2u;
+    Uint16 WinH2d;
+    Uint16 WinCY;
+    Uint16 WinSX;
+    Uint16 WinEX;
+    Uint16 WinSY;
+    Uint16 WinEY;
+    Uint16 WinW2;
+    Sint16 WinW2i;
+    Uint16 WallH;
+    Uint16 WallW;
+    Uint16 ObjectW;
+
+    // Floor and ceiling
+    Uint16 FloorW;      // texels per screen row, zero for texel per pixel
+    Uint16 FloorDiv;
+    Uint16 HXiFF;
+    Sint16 FLeftEnd;
+    Sint16 FRightEnd;
+    Sint16 CLeftEnd;
+    Sint16 CRightEnd;
+    Sint16 FLE160;
+
+    // Video mode
+    Uint16 VideoW;
+    Uint16 VideoH;
+    Uint16 VideoBPL;
+    Uint16 VideoEX;
+    Uint16 VideoEY;
+    Uint16 VideoCX;
+    Uint16 VideoCY;
+    Sint32 VPSize;
+    Uint8 Double;
+    bool VideoIsFlat;
+    Uint16 WinB;
+    Uint16 WinB3;
+    Uint16 WinE;
+    Uint16 WinE3;
+    Sint16 WXSize;
+
+    // Automap window
+    Sint16 WMapX1;
+    Sint16 WMapX2;
+    Sint16 WMapY1;
+    Sint16 WMapY2;
+    Sint16 WMapX;
+    Sint16 WMapY;
+    Sint16 mpk_x;
+    Sint16 mpk_y;
+    Sint16 mps;
+    Sint16 StepMove;
+
+    TViewConst();
+};
+
+
+// Per-frame render scratch, written and read in the innermost loops
+// Most frequently accessed fields go first
+struct TRenderState
+{
+    // View angle
+    Sint16 ica;
+    Sint16 isa;
+    Sint16 ica2;
+    Sint16 isa2;
+    Sint16 ica4;
+    Sint16 isa4;
+
+    // Texture stepping
+    Sint32 HLSt;
+    Sint32 CellV;
+    Sint32 FloorV;
+
+    // Screen span
+    Sint16 Sx1;
+    Sint16 Sx2;
+    Sint16 Sx11;
+    Sint16 Sx21;
+    Sint16 SxS;
+    Sint16 tx1;
+    Sint16 tx2;
+    Sint16 ty1;
+    Sint16 ty2;
+    Sint16 _ty1;
+    Sint16 DDark;
+    Sint32 Esl;
+    Sint32 Io0;
+    Sint32 SlY2;
+    Sint32 SLy;
+
+    // Column and segment clipping
+    Uint16 Hz;
+    Uint16 Hz2;
+    Uint16 DMax;
+    Uint16 Dy;
+    Uint16 DDY;
+    Uint16 oldy;
+    Uint16 _x1;
+    Uint16 _x2;
+    Uint16 _X;
+    Uint16 sl;
+    Uint16 slp;
+    Uint16 ys11;
+    Uint16 ys12;
+    Uint16 ys21;
+    Uint16 ys22;
+    Uint16 ys31;
+    Uint16 ys32;
+    Uint16 sh1;
+    Uint16 sh2;
+
+    // Holes and glass
+    Uint16 HlBr;
+    Uint16 HLxx;
+    Uint16 HLh1;
+    Uint16 Hlh2;
+    Uint16 Hlhr1;
+    Uint16 Hlhr2;
+    Uint16 HLRH;
+    Uint16 HLFh;
+
+    // Scanlines
+    Uint16 YMin1;
+    Uint16 YMin2;
+    Uint16 Nlines;
+    Uint16 NLines1;
+    Uint16 Cnt;
+    Uint16 FromOfs;
+    Uint16 FullH;
+    Uint16 yf0;
+    Uint16 yf1;
+    Uint16 yf2;
+
+    // Floor mapping
+    Uint16 DNp;
+    Sint16 DNpx;
+    Sint16 DNpy;
+    Sint16 FMapDx;
+    Sint16 FMapDy;
+    Sint16 FShwDx;
+    Sint16 FShwDy;
+    Uint16 TMy;
+    Uint16 FCurMapOfs;
+    Uint16 FMx;
+    Uint16 FMy;
+
+    // Wall vertices and hit point
+    Sint16 v1x;
+    Sint16 v1y;
+    Sint16 v2x;
+    Sint16 v2y;
+    Sint16 nx;
+    Sint16 ny;
+    Sint16 HS;
+    Sint16 Hx;
+    Sint16 Hy;
+    Sint16 HMx;
+    Sint16 HMy;
+    Sint16 ehx;
+    Sint16 ehy;
+    Sint16 ehz;
+
+    // Misc scratch
+    Sint16 DShift;
+    Sint16 Dir;
+    Sint16 lvz;
+    Sint16 hvz;
+    Sint32 EDI0;
+    Sint32 Edi1;
+    Sint32 mEDX;
+    Sint16 RSize;
+    Sint16 rrx;
+    Sint16 rry;
+    Sint16 nhxi;
+    Sint16 nhyi;
+    Sint16 aLwx;
+    Sint16 aLWy;
+    Sint16 DSh;
+    Sint16 LWx;
+    Sint16 LWy;
+    Sint16 Rx;
+    Sint16 Ry;
+    Sint16 R;
+    bool SkyVisible;
+    // Map cell of camera, selects set of visible cells
+    Uint16 ViewCell;
+
+    TRenderState();
+};
+
+
+// Game simulation state, updated once per tick
+struct TSimState
+{
+    // Timing
+    Uint16 takt;
+    Uint16 MsTakt;
+    Sint32 Time;
+    Sint32 Time0;
+    Sint32 ZTime;
+    Sint32 RealTime;
+    Uint16 CurTime;
+    Uint8 SecCounter;
+    bool NewSecond;
+    bool FirstTakt;
+    bool Paused;
+    bool IamDead;
+
+    // Level object counters
+    Uint16 DCount;
+    Uint16 LtCount;
+    Uint16 TCount;
+    Uint16 AmCount;
+    Uint16 ReCount;
+    Uint16 SFXSCount;
+
+    // Palette shades
+    Sint16 RShadeDir;
+    Sint16 RShadeLev;
+    Sint16 LastRShadeLev;
+    Sint16 GShadeDir;
+    Sint16 GShadeLev;
+    Sint16 LastGShadeLev;
+    Sint16 BShadeDir;
+    Sint16 BShadeLev;
+    Sint16 LastBShadeLev;
+
+    // Player
+    Sint16 LandZ;
+    Sint16 CeilZ;
+    Uint16 HFi;
+    Uint16 EHFi;
+    Sint16 HRv;
+    Uint16 HksFlags;
+    Sint16 LookVz;
+    Sint16 _LookVz;
+    Sint16 ShakeLevel;
+    Sint16 GunDx;
+    Sint16 GunDy;
+    Sint16 WpnShx;
+    Sint16 WpnShy;
+    bool WeaponActive;
+    Uint16 WeaponFTime;
+    Uint16 WeaponPhase;
+    Uint16 MTime;
+    Uint16 LastGunNumber;
+    Uint16 GunShift;
+    Uint16 MyDeath;
+    Sint32 LastPainTime;
+    Sint32 LastMouseTime;
+    Sint32 MSRND;
+    Uint16 Times10Sum;
+    Uint16 _Times10Sum;
+    Uint16 Frames10Count;
+
+    // Level statistics
+    Uint16 TotalKills;
+    Uint16 TotalKeys;
+    Sint16 EndDelay;
+    Uint16 BLevelDef;
+    Uint16 BLevel0;
+    Uint16 BLevelW;
+    Uint16 BlevelC;
+    Uint16 BLevelF;
+
+    TSimState();
+};
+
+
+// Configuration and user interface state, rarely accessed
+struct TConfigState
+{
+    // Menu and console
+    Uint16 MenuCode;
+    Sint16 MenuMode;
+    Sint16 MenuMainY;
+    bool MenuOn;
+    Uint16 LoadSaveY;
+    Uint16 OptionsY;
+    Uint16 CSCopy;
+    bool Console;
+    Sint16 ConsY;
+    Sint16 ConsDY;
+    Sint16 ConsMode;
+    Sint16 ConsMainY;
+    Sint16 ConsMenu;
+    Sint16 HistCnt;
+    Sint16 CurHist;
+
+    // Display modes
+    bool InfoPage;
+    bool TabMode;
+    bool MapMode;
+    bool FullMap;
+    bool TimeInd;
+    bool Ranking;
+    bool ExMode;
+
+    // Game options
+    Sint16 Skill;
+    Uint16 RespawnTime;
+    bool Monsters;
+    bool Animation;
+    bool ClipMode;
+    bool Slow;
+    bool Spline;
+    bool Chojin;
+    bool SafeLoad;
+    bool EpisodeReset;
+    bool AlwaysRun;
+    bool ReverseMouse;
+    bool Cocpit;
+
+    // Controls
+    Uint8 MSsens;
+    Uint8 _FrontOn;
+    Uint8 _BackOn;
+    Uint8 _LeftOn;
+    Uint8 _RightOn;
+    Uint8 _SLeftOn;
+    Uint8 _SRightOn;
+    Uint8 _JumpOn;
+    Uint8 _FireOn;
+    Uint8 _ChangOn;
+    Uint8 _StrafeOn;
+    Uint8 _SpeedUpOn;
+    Uint8 _MLookOn;
+    Uint8 _MLookT;
+    Uint8 _ViewUpOn;
+    Uint8 _ViewCntrOn;
+    Uint8 _ViewDnOn;
+    Uint8 Ms1ID;
+    Uint8 Ms2ID;
+    Uint8 ms3id;
+    bool MLookOn;
+    bool JoyStick;
+    bool MouseD;
+
+    // Multiplayer
+    OC::String SelfNick;
+    Uint8 SelfColor;
+
+    TConfigState();
+};
+
+
+extern TViewConst   View;
+extern TRenderState Render;
+extern TSimState    Sim;
+extern TConfigState Config;
+
 extern Uint16 ServerVersion;
 extern Sint32 Long1;
 extern Uint8 LB;
@@ -860,6 +1249,7 @@ extern void* ShadowMap;
 extern void* WShadowMap;
 extern void* ShadowMap2;
 extern void* WShadowMap2;
+// Tile in Floors of floor or ceiling texture number
 extern Uint16 FlSegs[256];
 extern OC::Bitmap Pc;
 extern OC::Bitmap CurPic;
@@ -881,19 +1271,25 @@ extern Uint8 CellMap[4096];
 extern Uint8* AltXTab;
 extern boost::array<TLight, 256> Lights;
 extern boost::array<Teleport, 128> Tports;
+// Wall textures in column-major layout, see Bitmap::createColumnMajor()
 extern boost::array<OC::Bitmap, 120> PImPtr;
 extern boost::array<Uint8, 120> WallMask;
 extern boost::array<TObjBMPInfo, 4> ObjBMPInf;
 extern boost::array<TObj3DInfo, 96> Obj3DInf;
-extern Uint16 LinesH1[847];
-extern Uint16 LinesH2[847];
-extern TLinesBuf LinesBUF;
-extern THoleItem* HolesList;
+// Walls drawn in view columns, replaces LinesBUF, LinesH1 and LinesH2
+extern OC::CoverageBuffer Coverage;
+extern std::vector<THoleItem> HolesList;
 extern boost::array<Uint8, 120> SpryteUsed;
 extern boost::array<Uint16, 201> Mul320;
-extern boost::array<Sint32, 701> MulSW;
+extern std::vector<Sint32> MulSW;
+// Distance to floor or ceiling seen at screen row, 16.16 fixed point in cells
+extern std::vector<Sint32> FloorDist;
 extern boost::array<Sint16, 1024> SinTab;
 extern boost::array<TLoc, 4096> Map;
+// Set of map cells, bit per cell
+typedef std::bitset<4096> TCellSet;
+// Cells visible from anywhere inside map cell, see csact::BuildVisibility()
+extern std::vector<TCellSet> VisibleCells;
 extern std::list<OC::String> ConsHistory;
 extern boost::array<Uint8, 4096> VMask;
 extern boost::array<Uint8, 4096> Flags;
@@ -904,13 +1300,19 @@ extern Uint8* FloorZHi;
 extern Uint8* FloorZLo;
 extern EndCamera__Type EndCamera;
 extern boost::array<TEvent, 16> EventsList;
-extern TFrame* FramesList;
-extern TBlow* BlowsList;
-extern TMonster MonstersList[90];
-extern TRocket RocketList[64];
-extern TSepPart SepList[32];
-extern TMine MinesList[16];
-extern TBlowLight BlowLights[32];
+
+// Transient render list, it's cleared at the end of every frame
+extern std::vector<TFrame> FramesList;
+
+extern std::vector<TBlow> BlowsList;
+extern OC::Pool<TMonster> MonstersList;
+extern OC::Pool<TRocket> RocketList;
+extern OC::Pool<TSepPart> SepList;
+extern OC::Pool<TMine> MinesList;
+extern OC::Pool<TBlowLight> BlowLights;
+
+// Set by -maxentities:N, replaces capacities of all pools above
+void SetEntityLimit(const size_t limit);
 
 // Monster numbers are 100..122
 static const size_t FIRST_MONSTER_INDEX = 100;
@@ -939,6 +1341,8 @@ extern OC::Bitmap Status;
 extern OC::Bitmap Loading;
 extern OC::Bitmap VesaTiler;
 extern OC::Bitmap SkyPtr;
+// Floor and ceiling textures, 64x64 tiles one below another
+extern OC::Bitmap Floors;
 
 typedef boost::array<Uint8, 0x10000> RGBTable;
 extern RGBTable RGBTab25;
@@ -947,24 +1351,10 @@ extern RGBTable RGBTab60;
 extern Uint16 LoadPos;
 extern OC::Real ca;
 extern OC::Real sa;
-extern Sint16 RShadeDir;
-extern Sint16 RShadeLev;
-extern Sint16 LastRShadeLev;
-extern Sint16 BShadeDir;
-extern Sint16 BShadeLev;
-extern Sint16 LastBShadeLev;
-extern Sint16 GShadeDir;
-extern Sint16 GShadeLev;
-extern Sint16 LastGShadeLev;
-extern Uint16 MenuCode;
-extern Uint16 CSCopy;
-extern Uint16 LoadSaveY;
-extern Uint16 OptionsY;
 extern Uint8 NetMode;
 extern Uint8 TeamMode;
 extern Uint8 SHRC;
 extern TMonster Ms;
-extern Sint16 Skill;
 extern Sint16 MyNetN;
 extern Sint16 bpx;
 extern Sint16 bpy;
@@ -973,80 +1363,17 @@ extern OC::Bitmap ConsolePtr;
 typedef std::list<OC::String> ConsoleText;
 extern ConsoleText ConsoleComm;
 
-extern Sint16 ConsY;
-extern Sint16 ConsDY;
-extern Sint16 ConsMode;
-extern Sint16 ConsMainY;
-extern Sint16 ConsMenu;
-extern Sint16 HistCnt;
-extern Sint16 CurHist;
-extern Sint16 MenuMode;
-extern Sint16 MenuMainY;
-extern Uint8 MSsens;
 extern Sint16 DisplaySett[3];
-extern Sint16 LandZ;
-extern Sint16 CeilZ;
-extern Sint16 EndDelay;
-extern Uint16 Hz;
-extern Uint16 Hz2;
-extern Uint16 DMax;
-extern Uint16 Dy;
-extern Uint16 DDY;
-extern Uint16 oldy;
-extern Uint16 _x1;
-extern Uint16 _x2;
-extern Uint16 _X;
-extern Uint16 sl;
-extern Uint16 slp;
 extern Uint16 t1;
-extern Uint16 Times10Sum;
-extern Uint16 _Times10Sum;
-extern Uint16 Frames10Count;
-extern Uint16 CurTime;
-extern Uint16 LastGunNumber;
-extern Uint16 GunShift;
-extern Uint16 RespawnTime;
-extern Uint16 ys31;
-extern Uint16 ys32;
-extern Uint16 ys11;
-extern Uint16 ys12;
-extern Uint16 ys21;
-extern Uint16 ys22;
-extern Uint16 sh1;
-extern Uint16 sh2;
 extern Uint16 mysy;
 extern Uint16 ObjectsLoaded;
 extern Uint16 WeaponsCount;
-extern Uint16 MCount;
-extern Uint16 TotalKills;
-extern Uint16 TotalKeys;
-extern Uint16 RCount;
-extern Uint16 BCount;
-extern Uint16 DCount;
-extern Uint16 FCount;
-extern Uint16 LCount;
-extern Uint16 LtCount;
-extern Uint16 SCount;
-extern Uint16 TCount;
-extern Uint16 MnCount;
-extern Uint16 AmCount;
-extern Uint16 ReCount;
-extern Uint16 HolCount;
-extern Uint16 SFXSCount;
 extern Uint16 InfoLen;
 extern Uint16 Di0;
 extern Uint16 Dx0;
 extern Uint16 Recsize;
-extern Uint16 MTime;
-extern Uint16 WeaponFTime;
-extern Uint16 WeaponPhase;
 extern Uint16 j;
 extern Uint16 w;
-extern Uint16 BLevelDef;
-extern Uint16 BLevel0;
-extern Uint16 BLevelW;
-extern Uint16 BlevelC;
-extern Uint16 BLevelF;
 extern Uint16 VgaSeg;
 extern Uint16 RGBSeg;
 extern Uint16 PSeg;
@@ -1056,228 +1383,35 @@ extern Uint16 ImSeg;
 extern Uint16 ImOfs;
 extern Uint16 Ims;
 extern Uint16 ImSegS;
-extern Uint16 MyDeath;
 extern Uint16 ObjectX;
 extern Uint16 ObjectY;
 extern Uint16 ObjSeg;
-extern Uint16 HlBr;
-extern Uint16 HLxx;
-extern Uint16 HLh1;
-extern Uint16 Hlh2;
-extern Uint16 Hlhr1;
-extern Uint16 Hlhr2;
-extern Uint16 HLRH;
-extern Uint16 HLFh;
-extern Uint16 YMin1;
-extern Uint16 YMin2;
-extern Uint16 Nlines;
-extern Uint16 NLines1;
-extern Uint16 takt;
-extern Uint16 MsTakt;
 extern Uint16 b0;
 extern Uint16 b1;
-extern bool WeaponActive;
-extern Sint32 CellV;
-extern Sint32 FloorV;
-extern Sint32 HLSt;
-extern Sint16 WXSize;
-extern Sint16 isa;
-extern Sint16 ica;
-extern Sint16 ica2;
-extern Sint16 isa2;
-extern Sint16 isa4;
-extern Sint16 ica4;
-extern Sint16 SxS;
-extern Sint16 Sx11;
-extern Sint16 Sx21;
-extern Sint16 Sx1;
-extern Sint16 Sx2;
-extern Sint16 DShift;
-extern Sint16 Dir;
-extern Sint16 WpnShx;
-extern Sint16 WpnShy;
-extern Sint16 lvz;
-extern Sint16 hvz;
-extern Sint16 GunDx;
-extern Sint16 GunDy;
-extern Sint16 ShakeLevel;
-extern Sint16 LookVz;
-extern Sint16 _LookVz;
-extern Sint16 v1x;
-extern Sint16 v1y;
-extern Sint16 v2x;
-extern Sint16 v2y;
-extern Sint16 nx;
-extern Sint16 ny;
-extern Sint16 HS;
-extern Sint16 Hx;
-extern Sint16 Hy;
-extern Sint16 HMx;
-extern Sint16 HMy;
-extern Sint16 ehx;
-extern Sint16 ehy;
-extern Sint16 ehz;
 extern Sint16 mi;
 extern Sint16 MapR;
 extern Sint16 LevelN;
 extern Sint16 ox;
-extern Sint16 HRv;
-extern Uint16 HksFlags;
-extern Uint16 HFi;
-extern Uint16 EHFi;
-extern bool FirstTakt;
-extern bool InfoPage;
 extern bool NextL;
 extern bool SERVER;
 extern bool CLIENT;
-extern bool Paused;
-extern bool Monsters;
-extern bool Animation;
-extern bool TimeInd;
-extern bool FullMap;
 extern bool EndOfTheGame;
-extern bool ClipMode;
-extern bool IamDead;
-extern bool Slow;
-extern bool Spline;
-extern bool Ranking;
-extern bool NewSecond;
 extern bool OAnimate;
-extern bool MapMode;
-extern bool ExMode;
-extern bool Chojin;
-extern bool TabMode;
-extern bool SafeLoad;
-extern bool EpisodeReset;
-extern bool AlwaysRun;
-extern bool ReverseMouse;
-extern bool SkyVisible;
-extern bool MenuOn;
-extern bool Console;
-extern bool Cocpit;
 extern bool GameActive;
-extern Uint8 SecCounter;
 extern void (*TimerInt)();
 extern void (*KbdInt)();
-extern Sint32 EDI0;
-extern Sint32 Edi1;
-extern Sint32 mEDX;
 extern Sint32 Ll;
-extern Sint32 Time0;
-extern Sint32 Time;
-extern Sint32 ZTime;
 extern Sint32 k;
-extern Sint32 RealTime;
-extern Sint32 LastMouseTime;
-extern Sint32 LastPainTime;
 extern Sint32 StartUpRandSeed;
-extern Sint32 MSRND;
 extern TLoc L;
-extern bool VideoIsFlat;
-extern Uint16 WinW;
-extern Uint16 WinW2;
-extern Uint16 WinSX;
-extern Uint16 WinEX;
-extern Uint16 WinSY;
-extern Uint16 WinEY;
-extern Uint16 WinH;
-extern Uint16 WinH2u;
-extern Uint16 WinH2d;
-extern Uint16 WinCY;
-extern Uint16 WallH;
-extern Uint16 WallW;
-extern Uint16 ObjectW;
-extern Uint16 WinB;
-extern Uint16 WinB3;
-extern Uint16 WinE;
-extern Uint16 WinE3;
-extern Sint16 WMapX1;
-extern Sint16 WMapX2;
-extern Sint16 WMapY1;
-extern Sint16 WMapY2;
-extern Sint16 WMapX;
-extern Sint16 WMapY;
-extern Sint16 mpk_x;
-extern Sint16 mpk_y;
-extern Sint16 mps;
-extern Sint16 WinW2i;
-extern Sint16 StepMove;
-extern Sint16 FLeftEnd;
-extern Sint16 FRightEnd;
-extern Sint16 CLeftEnd;
-extern Sint16 CRightEnd;
-extern Sint16 FLE160;
-extern Sint16 DNpy;
-extern Sint16 DNpx;
-extern Sint16 FMapDx;
-extern Sint16 FMapDy;
-extern Sint16 FShwDx;
-extern Sint16 FShwDy;
-extern Uint16 HXiFF;
-extern Uint16 FloorW;
-extern Uint16 FloorDiv;
-extern Uint16 TMy;
-extern Uint16 DNp;
-extern Uint16 FCurMapOfs;
-extern Uint16 FMx;
-extern Uint16 FMy;
-extern Sint32 Esl;
-extern Sint32 Io0;
-extern Sint32 SlY2;
-extern Sint32 SLy;
-extern Sint16 tx1;
-extern Sint16 tx2;
-extern Sint16 ty1;
-extern Sint16 ty2;
-extern Sint16 _ty1;
-extern Sint16 DDark;
 extern Uint16 WShadowOfs;
 extern Uint16 CMPOfs;
 extern Uint16 XOfsMask;
-extern Uint16 Cnt;
-extern Uint16 FromOfs;
-extern Uint16 FullH;
-extern Uint16 yf0;
-extern Uint16 yf1;
-extern Uint16 yf2;
 extern Uint16 ScrollK;
-extern Uint8 Double;
-extern Sint16 RSize;
-extern Sint16 rrx;
-extern Sint16 rry;
-extern Sint16 nhxi;
-extern Sint16 nhyi;
-extern Sint16 aLwx;
-extern Sint16 aLWy;
-extern Sint16 DSh;
-extern Sint16 LWx;
-extern Sint16 LWy;
-extern Sint16 Rx;
-extern Sint16 Ry;
-extern Sint16 R;
 extern bool KeysState[128];
 extern Uint8 KBDBuf[16];
 extern Uint16 KBDBufCnt;
 extern Uint8 KeysID[16];
-extern Uint8 _FrontOn;
-extern Uint8 _BackOn;
-extern Uint8 _LeftOn;
-extern Uint8 _RightOn;
-extern Uint8 _SLeftOn;
-extern Uint8 _SRightOn;
-extern Uint8 _JumpOn;
-extern Uint8 _FireOn;
-extern Uint8 _ChangOn;
-extern Uint8 _StrafeOn;
-extern Uint8 _SpeedUpOn;
-extern Uint8 _MLookOn;
-extern Uint8 _MLookT;
-extern Uint8 _ViewUpOn;
-extern Uint8 _ViewCntrOn;
-extern Uint8 _ViewDnOn;
-extern Uint8 Ms1ID;
-extern Uint8 Ms2ID;
-extern Uint8 ms3id;
 extern bool kbViewUp;
 extern bool kbViewDn;
 extern bool kbViewCntr;
@@ -1296,7 +1430,6 @@ extern Sint16 JoyMnX;
 extern Sint16 JoyMnY;
 extern Sint16 JoyMxX;
 extern Sint16 JoyMxY;
-extern bool JoyStick;
 extern bool JoyKeyA;
 extern bool JoyKeyB;
 extern Sint16 MsX;
@@ -1310,11 +1443,9 @@ extern Sint16 MsRv;
 extern Sint16 MsVV;
 extern Sint16 Msvvi;
 extern Sint16 msrvi;
-extern bool MouseD;
 extern bool MsKeyA;
 extern bool MsKeyB;
 extern bool MsKeyC;
-extern bool MLookOn;
 extern bool RecordDemo;
 extern bool PlayDemo;
 extern bool IPXPresent;
@@ -1327,8 +1458,6 @@ extern Uint8 NGPort;
 extern Uint8 NGBaud;
 extern Uint8 NGColor;
 extern OC::String::value_type NGNick[9];
-extern OC::String SelfNick;
-extern Uint8 SelfColor;
 extern TInfo_Struct* PInfoStruct;
 extern bool MSCDEX;
 extern Sint16 LCDTrack;
@@ -20,35 +20,1009 @@
 */
 
 #include "chasm.h"
+#include "cspbio.h"
+
+#include "oc/simd.h"
+#include "oc/utils.h"
 
 namespace Chasm
 {
 
+namespace
+{
+
+template <bool Transparent>
+void DrawColumn(Uint8* const dest, const int destPitch, const TWallSegment& segment, const TWallColumn& column)
+{
+    SDL_assert(NULL != dest);
+    SDL_assert(NULL != segment.Texture);
+    SDL_assert(NULL != segment.ColorMap);
+
+    const Uint8* const texture  = segment.Texture + column.Offset;
+    const Uint8* const colorMap = segment.ColorMap + column.Shade;
+
+    Uint8* pixel = dest + column.Y1 * destPitch;
+    Uint32 v = Uint32(column.V);
+
+    for (int y = column.Y1; y < column.Y2; ++y)
+    {
+        const Uint8 texel = texture[((Sint32(v) >> 16) & segment.VMask) << segment.RowShift];
+
+        if (!Transparent || 0xFF != texel)
+        {
+            *pixel = colorMap[texel];
+        }
+
+        pixel += destPitch;
+        v += Uint32(column.DV);
+    }
+}
+
+// Texels with color 255 are skipped, others are shaded and blended with screen color
+template <bool Inverse>
+void DrawGlassColumn(Uint8* const dest, const int destPitch,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* const blendTable)
+{
+    SDL_assert(NULL != dest);
+    SDL_assert(NULL != segment.Texture);
+    SDL_assert(NULL != segment.ColorMap);
+    SDL_assert(NULL != blendTable);
+
+    const Uint8* const texture  = segment.Texture + column.Offset;
+    const Uint8* const colorMap = segment.ColorMap + column.Shade;
+
+    Uint8* pixel = dest + column.Y1 * destPitch;
+    Uint32 v = Uint32(column.V);
+
+    for (int y = column.Y1; y < column.Y2; ++y)
+    {
+        const Uint8 texel = texture[((Sint32(v) >> 16) & segment.VMask) << segment.RowShift];
+
+        if (0xFF != texel)
+        {
+            const Uint8 color = colorMap[texel];
+            *pixel = Inverse ? blendTable[(*pixel << 8) + color] : blendTable[(color << 8) + *pixel];
+        }
+
+        pixel += destPitch;
+        v += Uint32(column.DV);
+    }
+}
+
+
+// ===========================================================================
+
+
+// ===========================================================================
+
+
+// Synthetic walls for measurements
+struct TWallTest
+{
+    std::vector<Uint8> Texture;
+    std::vector<Uint8> ColorMap;
+    TWallSegment Segment;
+    std::vector<TWallColumn> Columns;
+    std::vector<int> Lengths;
+    size_t Pixels;
+};
+
+// Texture is square, row-major, with power of two size
+void GenerateWalls(const int width, const int height, const int textureSize, TWallTest& test)
+{
+    static const int SHADE_LEVELS = 64;
+
+    int textureShift = 0;
+
+    while ((1 << textureShift) < textureSize)
+    {
+        ++textureShift;
+    }
+
+    SDL_assert((1 << textureShift) == textureSize);
+
+    test.Texture.resize(textureSize * textureSize);
+
+    for (size_t i = 0; i < test.Texture.size(); ++i)
+    {
+        // Every eighth texel is transparent on average
+        test.Texture[i] = 0 == rand() % 8 ? 0xFF : Uint8(rand());
+    }
+
+    test.ColorMap.resize(SHADE_LEVELS * 256);
+
+    for (size_t i = 0; i < test.ColorMap.size(); ++i)
+    {
+        test.ColorMap[i] = Uint8(rand());
+    }
+
+    test.Segment.Texture     = &test.Texture[0];
+    test.Segment.RowShift    = textureShift;
+    test.Segment.VMask       = textureSize - 1;
+    test.Segment.ColorMap    = &test.ColorMap[0];
+    test.Segment.Transparent = false;
+
+    test.Columns.resize(width);
+    test.Lengths.clear();
+    test.Pixels = 0;
+
+    // Walls of random lengths, also covering partial SIMD groups
+    for (int x = 0; x < width; )
+    {
+        const int length = std::min(1 + rand() % 64, width - x);
+
+        // Wall height changes linearly across screen as in perspective projection
+        const int height1 = height / 4 + rand() % (height * 3 / 4);
+        const int height2 = height / 4 + rand() % (height * 3 / 4);
+        const Sint32 v = rand() % textureSize << 16;
+        const Sint32 shade = rand() % SHADE_LEVELS * 256;
+
+        for (int i = 0; i < length; ++i)
+        {
+            TWallColumn& column = test.Columns[x + i];
+            const int columnHeight = height1 + (height2 - height1) * i / length;
+
+            column.Offset = (x + i) % textureSize;
+            column.V      = v;
+            column.DV     = (textureSize << 16) / columnHeight;
+            column.Shade  = shade;
+            column.Y1     = Sint16((height - columnHeight) / 2);
+            column.Y2     = Sint16(column.Y1 + columnHeight);
+
+            test.Pixels += columnHeight;
+        }
+
+        test.Lengths.push_back(length);
+        x += length;
+    }
+}
+
+// Transposes texture, so each column is read from sequential bytes
+void ConvertToColumnMajor(TWallTest& test)
+{
+    const int textureSize = test.Segment.VMask + 1;
+
+    std::vector<Uint8> transposed(test.Texture.size());
+
+    for (int x = 0; x < textureSize; ++x)
+    {
+        for (int y = 0; y < textureSize; ++y)
+        {
+            transposed[x * textureSize + y] = test.Texture[y * textureSize + x];
+        }
+    }
+
+    test.Texture.swap(transposed);
+    test.Segment.Texture = &test.Texture[0];
+
+    OC_FOREACH(TWallColumn& column, test.Columns)
+    {
+        column.Offset <<= test.Segment.RowShift;
+    }
+
+    test.Segment.RowShift = 0;
+}
+
+void DrawWalls(Uint8* const screen, const int pitch, const TWallTest& test)
+{
+    int x = 0;
+
+    for (size_t i = 0; i < test.Lengths.size(); ++i)
+    {
+        ShowSegment(screen, pitch, x, test.Segment, &test.Columns[x], test.Lengths[i]);
+        x += test.Lengths[i];
+    }
+}
+
+
+// ===========================================================================
+
+
+// Columns drawn at once by SIMD floor variants
+const int GROUP_SIZE = 16;
+
+// Texture number of map cell is read through one of maps
+enum FloorSurfaceType
+{
+    SURFACE_FLOOR,
+    SURFACE_CEILING
+};
+
+// Texel indices are made of position bits, 6 bits of texel and 6 bits of cell for each axis
+// Cell index is X * 64 + Y as in level map, texel index is row * 64 + column
+
+inline Uint32 FloorCell(const Uint32 u, const Uint32 v)
+{
+    return ((u >> 10) & 0xFC0) | ((v >> 16) & 63);
+}
+
+inline Uint32 FloorTexel(const Uint32 u, const Uint32 v)
+{
+    return ((v >> 4) & 0xFC0) | ((u >> 10) & 63);
+}
+
+inline Uint8 ShadeFloorTexel(const Uint8* const tiles, const Uint16* const tileIndex, const Uint8* const tileMap,
+    const Uint8* const colorMap, const Uint32 cell, const Uint32 texel)
+{
+    return colorMap[tiles[(Uint32(tileIndex[tileMap[cell]]) << FLOOR_TILE_SHIFT) + texel]];
+}
+
+// Sample positions are aligned to screen columns, so span split at any column
+// or drawn by any variant produces the same pixels
+void DrawSpanScalar(Uint8* const dest, const TFloorTextures& textures, const Uint8* const tileMap,
+    const TFloorSpan& span, const int x1, const int x2, const int detail)
+{
+    const int sampleMask = ~((1 << detail) - 1);
+    const Uint8* const colorMap = textures.ColorMap + span.Shade;
+
+    for (int x = x1; x < x2; )
+    {
+        const int sample = x & sampleMask;
+
+        const Uint32 u = Uint32(span.U) + Uint32(sample) * Uint32(span.DU);
+        const Uint32 v = Uint32(span.V) + Uint32(sample) * Uint32(span.DV);
+
+        const Uint8 color = ShadeFloorTexel(textures.Tiles, textures.TileIndex, tileMap,
+            colorMap, FloorCell(u, v), FloorTexel(u, v));
+
+        const int end = std::min(sample + (1 << detail), x2);
+
+        for (; x < end; ++x)
+        {
+            dest[x] = color;
+        }
+    }
+}
+
+// Draws groups of GROUP_SIZE columns from x1 to x2, both are multiples of GROUP_SIZE
+typedef void (*DrawSpanGroupsFunction)(Uint8* dest, const TFloorTextures& textures, const Uint8* tileMap,
+    const TFloorSpan& span, int x1, int x2, int detail);
+
+// Position offsets of samples relative to the first column of group
+void PrepareSpanLanes(const TFloorSpan& span, const int detail, Sint32* const laneU, Sint32* const laneV)
+{
+    const int sampleMask = ~((1 << detail) - 1);
+
+    for (int i = 0; i < GROUP_SIZE; ++i)
+    {
+        const Uint32 sample = Uint32(i & sampleMask);
+
+        laneU[i] = Sint32(sample * Uint32(span.DU));
+        laneV[i] = Sint32(sample * Uint32(span.DV));
+    }
+}
+
+// Positions and indices are calculated in vectors, tile and color map reads remain scalar,
+// each sample is read once and repeated for columns of lower detail
+
+#ifdef OC_SIMD_X86
+
+OC_SIMD_TARGET("sse2")
+void DrawSpanGroupsSSE2(Uint8* const dest, const TFloorTextures& textures, const Uint8* const tileMap,
+    const TFloorSpan& span, const int x1, const int x2, const int detail)
+{
+    Sint32 offsetU[GROUP_SIZE];
+    Sint32 offsetV[GROUP_SIZE];
+    PrepareSpanLanes(span, detail, offsetU, offsetV);
+
+    __m128i laneU[4];
+    __m128i laneV[4];
+
+    for (int k = 0; k < 4; ++k)
+    {
+        laneU[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&offsetU[k * 4]));
+        laneV[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&offsetV[k * 4]));
+    }
+
+    const __m128i highMask = _mm_set1_epi32(0xFC0);
+    const __m128i lowMask  = _mm_set1_epi32(63);
+
+    const Uint8* const tiles     = textures.Tiles;
+    const Uint16* const tileIndex = textures.TileIndex;
+    const Uint8* const colorMap  = textures.ColorMap + span.Shade;
+    const int step = 1 << detail;
+
+    for (int x = x1; x < x2; x += GROUP_SIZE)
+    {
+        const __m128i u = _mm_set1_epi32(Sint32(Uint32(span.U) + Uint32(x) * Uint32(span.DU)));
+        const __m128i v = _mm_set1_epi32(Sint32(Uint32(span.V) + Uint32(x) * Uint32(span.DV)));
+
+        Uint32 cells[GROUP_SIZE];
+        Uint32 texels[GROUP_SIZE];
+
+        for (int k = 0; k < 4; ++k)
+        {
+            const __m128i laneUPosition = _mm_add_epi32(u, laneU[k]);
+            const __m128i laneVPosition = _mm_add_epi32(v, laneV[k]);
+
+            const __m128i u10 = _mm_srli_epi32(laneUPosition, 10);
+
+            const __m128i cell  = _mm_or_si128(_mm_and_si128(u10, highMask),
+                _mm_and_si128(_mm_srli_epi32(laneVPosition, 16), lowMask));
+            const __m128i texel = _mm_or_si128(_mm_and_si128(_mm_srli_epi32(laneVPosition, 4), highMask),
+                _mm_and_si128(u10, lowMask));
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&cells [k * 4]), cell);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(&texels[k * 4]), texel);
+        }
+
+        Uint8 shaded[GROUP_SIZE];
+
+        for (int i = 0; i < GROUP_SIZE; i += step)
+        {
+            const Uint8 color = ShadeFloorTexel(tiles, tileIndex, tileMap, colorMap, cells[i], texels[i]);
+
+            for (int j = 0; j < step; ++j)
+            {
+                shaded[i + j] = color;
+            }
+        }
+
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x),
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(shaded)));
+    }
+}
+
+#endif // OC_SIMD_X86
+
+#ifdef OC_SIMD_NEON
+
+void DrawSpanGroupsNEON(Uint8* const dest, const TFloorTextures& textures, const Uint8* const tileMap,
+    const TFloorSpan& span, const int x1, const int x2, const int detail)
+{
+    Sint32 offsetU[GROUP_SIZE];
+    Sint32 offsetV[GROUP_SIZE];
+    PrepareSpanLanes(span, detail, offsetU, offsetV);
+
+    uint32x4_t laneU[4];
+    uint32x4_t laneV[4];
+
+    for (int k = 0; k < 4; ++k)
+    {
+        laneU[k] = vreinterpretq_u32_s32(vld1q_s32(&offsetU[k * 4]));
+        laneV[k] = vreinterpretq_u32_s32(vld1q_s32(&offsetV[k * 4]));
+    }
+
+    const uint32x4_t highMask = vdupq_n_u32(0xFC0);
+    const uint32x4_t lowMask  = vdupq_n_u32(63);
+
+    const Uint8* const tiles     = textures.Tiles;
+    const Uint16* const tileIndex = textures.TileIndex;
+    const Uint8* const colorMap  = textures.ColorMap + span.Shade;
+    const int step = 1 << detail;
+
+    for (int x = x1; x < x2; x += GROUP_SIZE)
+    {
+        const uint32x4_t u = vdupq_n_u32(Uint32(span.U) + Uint32(x) * Uint32(span.DU));
+        const uint32x4_t v = vdupq_n_u32(Uint32(span.V) + Uint32(x) * Uint32(span.DV));
+
+        Uint32 cells[GROUP_SIZE];
+        Uint32 texels[GROUP_SIZE];
+
+        for (int k = 0; k < 4; ++k)
+        {
+            const uint32x4_t laneUPosition = vaddq_u32(u, laneU[k]);
+            const uint32x4_t laneVPosition = vaddq_u32(v, laneV[k]);
+
+            const uint32x4_t u10 = vshrq_n_u32(laneUPosition, 10);
+
+            vst1q_u32(&cells[k * 4], vorrq_u32(vandq_u32(u10, highMask),
+                vandq_u32(vshrq_n_u32(laneVPosition, 16), lowMask)));
+            vst1q_u32(&texels[k * 4], vorrq_u32(vandq_u32(vshrq_n_u32(laneVPosition, 4), highMask),
+                vandq_u32(u10, lowMask)));
+        }
+
+        Uint8 shaded[GROUP_SIZE];
+
+        for (int i = 0; i < GROUP_SIZE; i += step)
+        {
+            const Uint8 color = ShadeFloorTexel(tiles, tileIndex, tileMap, colorMap, cells[i], texels[i]);
+
+            for (int j = 0; j < step; ++j)
+            {
+                shaded[i + j] = color;
+            }
+        }
+
+        vst1q_u8(dest + x, vld1q_u8(shaded));
+    }
+}
+
+#endif // OC_SIMD_NEON
+
+// Returns NULL when there is no dedicated variant for given instruction set
+DrawSpanGroupsFunction SelectDrawSpanGroups(const OC::SIMDType type)
+{
+    switch (type)
+    {
+#ifdef OC_SIMD_X86
+    case OC::SIMD_SSE2:
+        return DrawSpanGroupsSSE2;
+#endif // OC_SIMD_X86
+
+#ifdef OC_SIMD_NEON
+    case OC::SIMD_NEON:
+        return DrawSpanGroupsNEON;
+#endif // OC_SIMD_NEON
+
+    default:
+        return NULL;
+    }
+}
+
+void DrawSpan(const OC::SIMDType type, Uint8* const dest, const TFloorTextures& textures,
+    const FloorSurfaceType surface, const TFloorSpan& span, const int detail)
+{
+    SDL_assert(NULL != dest);
+    SDL_assert(NULL != textures.Tiles);
+    SDL_assert(NULL != textures.TileIndex);
+    SDL_assert(NULL != textures.ColorMap);
+    SDL_assert(detail >= 0 && detail <= 2);
+
+    const Uint8* const tileMap = SURFACE_FLOOR == surface ? textures.FloorMap : textures.CellMap;
+    SDL_assert(NULL != tileMap);
+
+    const DrawSpanGroupsFunction drawGroups = SelectDrawSpanGroups(type);
+
+    int x = span.X1;
+
+    if (NULL != drawGroups)
+    {
+        // Groups are aligned to screen columns, the rest is drawn by scalar code
+        const int groupsBegin = (x + GROUP_SIZE - 1) & ~(GROUP_SIZE - 1);
+        const int groupsEnd   = span.X2 & ~(GROUP_SIZE - 1);
+
+        if (groupsBegin < groupsEnd)
+        {
+            DrawSpanScalar(dest, textures, tileMap, span, x, groupsBegin, detail);
+            drawGroups(dest, textures, tileMap, span, groupsBegin, groupsEnd, detail);
+
+            x = groupsEnd;
+        }
+    }
+
+    DrawSpanScalar(dest, textures, tileMap, span, x, span.X2, detail);
+}
+
+
+// ===========================================================================
+
+
+// Synthetic floor for measurements
+struct TFloorTest
+{
+    std::vector<Uint8> Tiles;
+    std::vector<Uint16> TileIndex;
+    std::vector<Uint8> Map;
+    std::vector<Uint8> ColorMap;
+    TFloorTextures Textures;
+    std::vector<TFloorSpan> Spans;
+    size_t Pixels;
+};
+
+// Spans of one screen row each, as seen from the center of map with 90 degrees field of view
+void GenerateFloors(const int width, const int height, TFloorTest& test)
+{
+    static const int TILE_COUNT   = 16;
+    static const int SHADE_LEVELS = 64;
+    static const int MAP_CELLS    = 4096;
+
+    // View direction is not parallel to map axes
+    static const OC::Double DIRECTION_X = 0.8;
+    static const OC::Double DIRECTION_Y = 0.6;
+
+    test.Tiles.resize(TILE_COUNT << FLOOR_TILE_SHIFT);
+
+    for (size_t i = 0; i < test.Tiles.size(); ++i)
+    {
+        test.Tiles[i] = Uint8(rand());
+    }
+
+    test.TileIndex.resize(256);
+
+    for (size_t i = 0; i < test.TileIndex.size(); ++i)
+    {
+        test.TileIndex[i] = Uint16(rand() % TILE_COUNT);
+    }
+
+    test.Map.resize(MAP_CELLS);
+
+    for (size_t i = 0; i < test.Map.size(); ++i)
+    {
+        test.Map[i] = Uint8(rand());
+    }
+
+    test.ColorMap.resize(SHADE_LEVELS * 256);
+
+    for (size_t i = 0; i < test.ColorMap.size(); ++i)
+    {
+        test.ColorMap[i] = Uint8(rand());
+    }
+
+    test.Textures.Tiles     = &test.Tiles[0];
+    test.Textures.TileIndex = &test.TileIndex[0];
+    test.Textures.FloorMap  = &test.Map[0];
+    test.Textures.CellMap   = &test.Map[0];
+    test.Textures.ColorMap  = &test.ColorMap[0];
+
+    test.Spans.resize(height / 2);
+    test.Pixels = 0;
+
+    for (int y = 0; y < height / 2; ++y)
+    {
+        // Half of the row is behind walls on average, spans start and end at random columns
+        const OC::Double distance = width / 4.0 / (y + 0.5);
+        const int x1 = rand() % (width / 2);
+        const int x2 = x1 + rand() % (width - x1);
+
+        TFloorSpan& span = test.Spans[y];
+
+        span.U     = Sint32((32.0 + distance * (DIRECTION_X + DIRECTION_Y)) * 65536.0);
+        span.V     = Sint32((32.0 + distance * (DIRECTION_Y - DIRECTION_X)) * 65536.0);
+        span.DU    = Sint32(-distance * DIRECTION_Y * 2.0 / width * 65536.0);
+        span.DV    = Sint32( distance * DIRECTION_X * 2.0 / width * 65536.0);
+        span.Shade = std::min(int(distance), SHADE_LEVELS - 1) * 256;
+        span.X1    = Sint16(x1);
+        span.X2    = Sint16(x2);
+
+        test.Pixels += x2 - x1;
+    }
+}
+
+void DrawFloors(const OC::SIMDType type, Uint8* const screen, const int pitch, const TFloorTest& test, const int detail)
+{
+    for (size_t y = 0; y < test.Spans.size(); ++y)
+    {
+        DrawSpan(type, screen + y * pitch, test.Textures, SURFACE_FLOOR, test.Spans[y], detail);
+    }
+}
+
+bool HasFloorVariant(const OC::SIMDType type)
+{
+    return OC::IsSIMDSupported(type) && (OC::SIMD_NONE == type || NULL != SelectDrawSpanGroups(type));
+}
+
+OC::SIMDType SelectFastestFloors()
+{
+    static const int WIDTH  = 640;
+    static const int HEIGHT = 480;
+    static const int RUNS   = 4;
+
+    TFloorTest test;
+    GenerateFloors(WIDTH, HEIGHT, test);
+
+    std::vector<Uint8> screen(WIDTH * HEIGHT);
+
+    OC::SIMDType result = OC::SIMD_NONE;
+    Uint64 resultTime = Uint64(-1);
+
+    for (int t = 0; t < OC::SIMD_COUNT; ++t)
+    {
+        const OC::SIMDType type = OC::SIMDType(t);
+
+        if (!HasFloorVariant(type))
+        {
+            continue;
+        }
+
+        Uint64 bestTime = Uint64(-1);
+
+        for (int i = 0; i < RUNS; ++i)
+        {
+            const Uint64 start = SDL_GetPerformanceCounter();
+
+            DrawFloors(type, &screen[0], WIDTH, test, 0);
+
+            bestTime = std::min(bestTime, SDL_GetPerformanceCounter() - start);
+        }
+
+        if (bestTime < resultTime)
+        {
+            result = type;
+            resultTime = bestTime;
+        }
+    }
+
+    SDL_Log("Floor renderer uses %s variant", OC::SIMDName(result));
+
+    return result;
+}
+
+// Chosen by SelectRenderVariants() on main thread, worker threads only read it
+OC::SIMDType FloorType = OC::SIMD_NONE;
+bool VariantsSelected = false;
+
+void DrawSpan(Uint8* const dest, const TFloorTextures& textures,
+    const FloorSurfaceType surface, const TFloorSpan& span, const int detail)
+{
+    SDL_assert(VariantsSelected);
+
+    DrawSpan(FloorType, dest, textures, surface, span, detail);
+}
+
+// Sky texture column for every column of full turn plus one view width
+std::vector<Uint16> SkyColumns;
+Uint16 SkyWidth;
+
+} // unnamed namespace
+
+
+Uint16 SkyX;
+Uint16 SkyY;
+bool InversGlass;
+
+void SelectRenderVariants()
+{
+    if (VariantsSelected)
+    {
+        return;
+    }
+
+    // Texel and tile reads are scalar in all variants, so SIMD is not always faster
+    FloorType = SelectFastestFloors();
+
+    VariantsSelected = true;
+}
+
 Sint16 MulVectors(/*...*/);
 bool Test2Vectors(/*...*/);
-void VILineL(/*...*/);
+
+void VILineL(Uint8* const dest, const int destPitch, const TWallSegment& segment, const TWallColumn& column)
+{
+    DrawColumn<false>(dest, destPitch, segment, column);
+}
+
 void VILineL_hi(/*...*/);
-void ShowLine(/*...*/);
-void ShowLine2(/*...*/);
-void ShowGlassLine(/*...*/);
-void ShowGlassLine2(/*...*/);
-void ShowGlassLine4(/*...*/);
-void ShowSegment(/*...*/);
-void ShowSegment2(/*...*/);
-void VIlinePack(/*...*/);
+
+void ShowLine(Uint8* const screen, const int pitch, const int x, const TWallSegment& segment, const TWallColumn& column)
+{
+    if (segment.Transparent)
+    {
+        VIlinePack(screen + x, pitch, segment, column);
+    }
+    else
+    {
+        VILineL(screen + x, pitch, segment, column);
+    }
+}
+
+void ShowLine2(Uint8* const screen, const int pitch, const int x, const TWallSegment& segment, const TWallColumn& column)
+{
+    ShowLine(screen, pitch, x,     segment, column);
+    ShowLine(screen, pitch, x + 1, segment, column);
+}
+
+void ShowGlassLine(Uint8* const screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* const blendTable)
+{
+    if (InversGlass)
+    {
+        DrawGlassColumn<true>(screen + x, pitch, segment, column, blendTable);
+    }
+    else
+    {
+        DrawGlassColumn<false>(screen + x, pitch, segment, column, blendTable);
+    }
+}
+
+void ShowGlassLine2(Uint8* const screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* const blendTable)
+{
+    ShowGlassLine(screen, pitch, x,     segment, column, blendTable);
+    ShowGlassLine(screen, pitch, x + 1, segment, column, blendTable);
+}
+
+void ShowGlassLine4(Uint8* const screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn& column, const Uint8* const blendTable)
+{
+    ShowGlassLine2(screen, pitch, x,     segment, column, blendTable);
+    ShowGlassLine2(screen, pitch, x + 2, segment, column, blendTable);
+}
+
+void ShowSegment(Uint8* const screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn* const columns, const int count)
+{
+    SDL_assert(NULL != screen);
+    SDL_assert(NULL != columns || 0 == count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        ShowLine(screen, pitch, x + i, segment, columns[i]);
+    }
+}
+
+void ShowSegment2(Uint8* const screen, const int pitch, const int x,
+    const TWallSegment& segment, const TWallColumn* const columns, const int count)
+{
+    SDL_assert(NULL != columns || 0 == count);
+
+    for (int i = 0; i < count; ++i)
+    {
+        ShowLine2(screen, pitch, x + i * 2, segment, columns[i]);
+    }
+}
+
+void VIlinePack(Uint8* const dest, const int destPitch, const TWallSegment& segment, const TWallColumn& column)
+{
+    DrawColumn<true>(dest, destPitch, segment, column);
+}
+
 void VIlineUpPack(/*...*/);
-void Draw_Cell1(/*...*/);
-void Draw_Cell2(/*...*/);
-void Draw_Cell3(/*...*/);
-void CellVHi(/*...*/);
-void Draw_Floor1(/*...*/);
-void Draw_Floor2(/*...*/);
-void Draw_Floor3(/*...*/);
-void FloorVHi(/*...*/);
+
+void Draw_Cell1(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_CEILING, span, 0);
+}
+
+void Draw_Cell2(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_CEILING, span, 1);
+}
+
+void Draw_Cell3(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_CEILING, span, 2);
+}
+
+void CellVHi(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span, const int detail)
+{
+    DrawSpan(dest, textures, SURFACE_CEILING, span, detail);
+}
+
+void Draw_Floor1(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_FLOOR, span, 0);
+}
+
+void Draw_Floor2(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_FLOOR, span, 1);
+}
+
+void Draw_Floor3(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span)
+{
+    DrawSpan(dest, textures, SURFACE_FLOOR, span, 2);
+}
+
+void FloorVHi(Uint8* const dest, const TFloorTextures& textures, const TFloorSpan& span, const int detail)
+{
+    DrawSpan(dest, textures, SURFACE_FLOOR, span, detail);
+}
+
 void MovEX(/*...*/);
-void BuildSky(/*...*/);
+
+void BuildSky()
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+    const OC::Bitmap& sky = CSPBIO::SkyPtr;
+
+    CSPBIO::Render.SkyVisible = sky.isValid();
+
+    if (!sky.isValid())
+    {
+        return;
+    }
+
+    // Field of view is 90 degrees, so full turn is four view widths
+    const int turn  = view.WinW * 4;
+    const int width = turn + view.WinW;
+
+    // Sky is drawn straight from its texture, only the map of screen columns
+    // to texture columns depends on the view size, so mode change is cheap
+    // View wider than the rest of turn is covered by repeated entries
+    if (width != int(SkyColumns.size()) || sky.width() != SkyWidth)
+    {
+        SkyColumns.resize(width);
+        SkyWidth = sky.width();
+
+        for (int x = 0; x < width; ++x)
+        {
+            SkyColumns[x] = Uint16(x % turn * SkyWidth / turn);
+        }
+    }
+
+    SkyX = Uint16((CSPBIO::Sim.HFi * turn / 65536 + turn - view.WinW / 2) % turn);
+
+    // Level view shows upper half of sky, look offset is in rows of 200 lines high screen
+    const int height = view.WinH;
+    const int look = CSPBIO::Sim.LookVz * height / 200;
+    SkyY = Uint16(std::max(0, std::min(height / 4 - look, height / 2)));
+}
+
+void ShowSky(Uint8* const dest, const int row, const int x1, const int x2)
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+    const OC::Bitmap& sky = CSPBIO::SkyPtr;
+
+    SDL_assert(NULL != dest);
+    SDL_assert(sky.isValid());
+    SDL_assert(x1 >= 0 && x2 <= int(SkyColumns.size()) - SkyX);
+
+    const int skyRow = std::min(SkyY + row, view.WinH - 1) * sky.height() / view.WinH;
+    const Uint8* const source = sky.pixels() + skyRow * sky.pitch();
+    const Uint16* const columns = &SkyColumns[SkyX];
+
+    for (int x = x1; x < x2; ++x)
+    {
+        dest[x] = source[columns[x]];
+    }
+}
+
 void BuildFloorCell(/*...*/);
 void DrawCross(/*...*/);
 void ShowValue(/*...*/);
 
-} // namespace CSPUTL
+
+// ===========================================================================
+
+
+void BenchmarkWalls()
+{
+    static const int RESOLUTIONS[][2] =
+    {
+        {  640,  480 },
+        { 1920, 1080 },
+        { 3840, 2160 },
+    };
+
+    static const int TEXTURE_SIZES[] = { 64, 256 };
+
+    // Minimal measurement time for each variant, in seconds
+    static const OC::Double MEASURE_TIME = 0.25;
+
+    const OC::Double frequency = OC::Double(SDL_GetPerformanceFrequency());
+
+    SDL_Log("Wall renderer benchmark");
+
+    for (size_t r = 0; r < SDL_arraysize(RESOLUTIONS); ++r)
+    {
+        const int width  = RESOLUTIONS[r][0];
+        const int height = RESOLUTIONS[r][1];
+        const size_t pixelCount = size_t(width) * height;
+
+        for (size_t s = 0; s < SDL_arraysize(TEXTURE_SIZES); ++s)
+        {
+            const int textureSize = TEXTURE_SIZES[s];
+
+            TWallTest test;
+            GenerateWalls(width, height, textureSize, test);
+
+            // Results with row-major texture, column-major one must match them
+            std::vector<Uint8> reference[2];
+            std::vector<Uint8> result(pixelCount);
+
+            for (int layout = 0; layout < 2; ++layout)
+            {
+                const bool columnMajor = 1 == layout;
+
+                if (columnMajor)
+                {
+                    ConvertToColumnMajor(test);
+                }
+
+                for (int transparent = 0; transparent < 2; ++transparent)
+                {
+                    test.Segment.Transparent = 0 != transparent;
+
+                    // Walls cover the same pixels every time, so clearing once is enough
+                    std::fill(result.begin(), result.end(), 0);
+
+                    const Uint64 start = SDL_GetPerformanceCounter();
+                    Uint64 now = start;
+                    int frames = 0;
+
+                    do
+                    {
+                        DrawWalls(&result[0], width, test);
+
+                        ++frames;
+                        now = SDL_GetPerformanceCounter();
+                    }
+                    while ((now - start) / frequency < MEASURE_TIME);
+
+                    const OC::Double seconds = (now - start) / frequency / frames;
+
+                    if (reference[transparent].empty())
+                    {
+                        reference[transparent] = result;
+                    }
+
+                    const bool exact = 0 == SDL_memcmp(&reference[transparent][0], &result[0], pixelCount);
+
+                    SDL_Log("  %4ix%-4i %3ix%-3i %-6s %-11s %8.3f ms %7.1f Mpixels/s%s",
+                        width, height, textureSize, textureSize, columnMajor ? "column" : "row",
+                        test.Segment.Transparent ? "transparent" : "opaque",
+                        seconds * 1000.0, test.Pixels / seconds / 1000000.0, exact ? "" : "  MISMATCH");
+
+                    if (!exact)
+                    {
+                        OC::DoHalt("Wall renderer output depends on texture layout.");
+                    }
+                }
+            }
+        }
+    }
+}
+
+void BenchmarkFloors()
+{
+    static const int RESOLUTIONS[][2] =
+    {
+        {  640,  480 },
+        { 1920, 1080 },
+        { 3840, 2160 },
+    };
+
+    static const char* const DETAIL_NAMES[] = { "full", "half", "quarter" };
+
+    // Minimal measurement time for each variant, in seconds
+    static const OC::Double MEASURE_TIME = 0.25;
+
+    const OC::Double frequency = OC::Double(SDL_GetPerformanceFrequency());
+
+    SDL_Log("Floor renderer benchmark, widest instruction set is %s", OC::SIMDName(OC::BestSIMD()));
+
+    for (size_t r = 0; r < SDL_arraysize(RESOLUTIONS); ++r)
+    {
+        const int width  = RESOLUTIONS[r][0];
+        const int height = RESOLUTIONS[r][1];
+        const size_t pixelCount = size_t(width) * height;
+
+        TFloorTest test;
+        GenerateFloors(width, height, test);
+
+        std::vector<Uint8> result(pixelCount);
+
+        for (int detail = 0; detail < int(SDL_arraysize(DETAIL_NAMES)); ++detail)
+        {
+            // Result of scalar variant
+            std::vector<Uint8> reference;
+
+            for (int t = 0; t < OC::SIMD_COUNT; ++t)
+            {
+                const OC::SIMDType type = OC::SIMDType(t);
+
+                if (!HasFloorVariant(type))
+                {
+                    continue;
+                }
+
+                // Spans cover the same pixels every time, so clearing once is enough
+                std::fill(result.begin(), result.end(), 0);
+
+                const Uint64 start = SDL_GetPerformanceCounter();
+                Uint64 now = start;
+                int frames = 0;
+
+                do
+                {
+                    DrawFloors(type, &result[0], width, test, detail);
+
+                    ++frames;
+                    now = SDL_GetPerformanceCounter();
+                }
+                while ((now - start) / frequency < MEASURE_TIME);
+
+                const OC::Double seconds = (now - start) / frequency / frames;
+
+                if (reference.empty())
+                {
+                    reference = result;
+                }
+
+                const bool exact = 0 == SDL_memcmp(&reference[0], &result[0], pixelCount);
+
+                SDL_Log("  %4ix%-4i %-7s %-6s %8.3f ms %7.1f Mpixels/s%s",
+                    width, height, DETAIL_NAMES[detail], OC::SIMDName(type),
+                    seconds * 1000.0, test.Pixels / seconds / 1000000.0, exact ? "" : "  MISMATCH");
+
+                if (!exact)
+                {
+                    OC::DoHalt(OC::Format("Floor renderer variant %1% differs from scalar one.") % OC::SIMDName(type));
+                }
+            }
+        }
+    }
+}
+
+} // namespace Chasm
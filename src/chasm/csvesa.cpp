@@ -40,53 +40,25 @@ void vesa_DrawKey(/*...*/);
 
 void ReDrawGround()
 {
-    const Uint16 screenWidth  = OC::Renderer::instance().screenWidth();
-    const Uint16 screenHeight = OC::Renderer::instance().screenHeight();
+    // Tiled ground is cached, so redraw is a single copy
+    OC::Renderer::instance().setBackground(Ground);
+    OC::Renderer::instance().drawBackground();
+}
 
-    const Uint16 groundWidth  = Ground.width();
-    const Uint16 groundHeight = Ground.height();
+void SetVideoMode(const Uint16 width, const Uint16 height)
+{
+    // Replaces Init320x200() and Init_HiMode()
 
-    for (Uint16 y = 0; y < screenHeight; y += groundHeight)
-    {
-        for (Uint16 x = 0; x < screenWidth; x += groundWidth)
-        {
-            OC::Renderer::instance().draw(Ground, x, y);
-        }
-    }
-}
+    const Uint16 videoW = std::max(MIN_VIDEO_WIDTH,  std::min(width,  MAX_VIDEO_WIDTH ));
+    const Uint16 videoH = std::max(MIN_VIDEO_HEIGHT, std::min(height, MAX_VIDEO_HEIGHT));
 
-//void SetVideoMode()
-//{
-//    // Replaces Init320x200() and Init_HiMode()
-//
-//    // TODO: remove hard-coded 640x480
-//    VideoW   = 640;
-//    VideoH   = 480;
-//    VideoBPL = VideoW;
-//
-//    FloorDiv = VideoW + 16 / 32;
-//
-//    VideoEX = VideoW - 1;
-//    VideoEY = VideoH - 1;
-//
-//    VideoCX = VideoW / 2;
-//    VideoCY = VideoH / 2;
-//
-//    VPSize  = VideoBPL * VideoH;
-//
-//    for (size_t i = 0; i < MulSW.size(); ++i)
-//    {
-//        MulSW[i] = Sint32(VideoBPL * i);
-//    }
-//
-//    LinesBUF.LinesS.fill(-1);
-//    LinesBUF.LinesO.fill(-1);
-//    LinesBUF.LinesFH1.fill(-1);
-//    LinesBUF.LinesFH2.fill(-1);
-//    LinesBUF.LinesB.fill(-1);
-//
-//    PutConsMessage2((OC::Format("Mode: %1%x%2%") % VideoW % VideoH).str());
-//}
+    OC::Renderer::instance().setVideoMode(videoW, videoH);
+
+    ReInitViewConst(videoW, videoH);
+    ReDrawGround();
+
+    PutConsMessage2((OC::Format("Mode: %1%x%2%") % videoW % videoH).str());
+}
 
 void VESAGetDosMem(/*...*/);
 void VESAFreeDosMem(/*...*/);
@@ -0,0 +1,290 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/coverage.h"
+
+#include "oc/utils.h"
+
+namespace OC
+{
+
+namespace
+{
+
+const int FINE_SIZE   = 1 << CoverageBuffer::FINE_SHIFT;
+const int COARSE_SIZE = 1 << CoverageBuffer::COARSE_SHIFT;
+
+struct TestRectangle
+{
+    int x1;
+    int x2;
+    int y1;
+    int y2;
+    Sint32 depth;
+};
+
+} // unnamed namespace
+
+
+CoverageBuffer::CoverageBuffer()
+{
+
+}
+
+void CoverageBuffer::resize(const int width)
+{
+    SDL_assert(width >= 0);
+
+    m_y1   .assign(width, 0);
+    m_y2   .assign(width, 0);
+    m_depth.assign(width, std::numeric_limits<Sint32>::max());
+
+    m_fine  .resize((width + FINE_SIZE   - 1) >> FINE_SHIFT);
+    m_coarse.resize((width + COARSE_SIZE - 1) >> COARSE_SHIFT);
+
+    updateGroups(0, width);
+}
+
+void CoverageBuffer::setColumn(const int x, const Sint16 y1, const Sint16 y2, const Sint32 depth)
+{
+    SDL_assert(x >= 0 && x < width());
+
+    // Empty interval is stored as the same row, so group intersections stay empty too
+    m_y1[x]    = y1;
+    m_y2[x]    = std::max(y1, y2);
+    m_depth[x] = depth;
+}
+
+void CoverageBuffer::updateGroups(const int x1, const int x2)
+{
+    SDL_assert(0 == (x1 & (COARSE_SIZE - 1)));
+    SDL_assert(x2 >= x1 && x2 <= width());
+
+    for (int g = x1 >> FINE_SHIFT; g < (x2 + FINE_SIZE - 1) >> FINE_SHIFT; ++g)
+    {
+        Group& group = m_fine[g];
+        group.y1    = std::numeric_limits<Sint16>::min();
+        group.y2    = std::numeric_limits<Sint16>::max();
+        group.depth = std::numeric_limits<Sint32>::min();
+
+        for (int x = g << FINE_SHIFT; x < std::min((g + 1) << FINE_SHIFT, width()); ++x)
+        {
+            merge(group, m_y1[x], m_y2[x], m_depth[x]);
+        }
+    }
+
+    for (int g = x1 >> COARSE_SHIFT; g < (x2 + COARSE_SIZE - 1) >> COARSE_SHIFT; ++g)
+    {
+        Group& group = m_coarse[g];
+        group.y1    = std::numeric_limits<Sint16>::min();
+        group.y2    = std::numeric_limits<Sint16>::max();
+        group.depth = std::numeric_limits<Sint32>::min();
+
+        const int fineEnd = std::min((g + 1) << (COARSE_SHIFT - FINE_SHIFT), int(m_fine.size()));
+
+        for (int f = g << (COARSE_SHIFT - FINE_SHIFT); f < fineEnd; ++f)
+        {
+            merge(group, m_fine[f].y1, m_fine[f].y2, m_fine[f].depth);
+        }
+    }
+}
+
+void CoverageBuffer::merge(Group& group, const Sint16 y1, const Sint16 y2, const Sint32 depth)
+{
+    group.y1    = std::max(group.y1, y1);
+    group.y2    = std::min(group.y2, y2);
+    group.depth = std::max(group.depth, depth);
+}
+
+int CoverageBuffer::findOpen(int x1, const int x2, const int y) const
+{
+    SDL_assert(x1 >= 0 && x2 <= width());
+
+    while (x1 < x2)
+    {
+        if (0 == (x1 & (COARSE_SIZE - 1)) && x1 + COARSE_SIZE <= x2 && isRowCovered(m_coarse[x1 >> COARSE_SHIFT], y))
+        {
+            x1 += COARSE_SIZE;
+        }
+        else if (0 == (x1 & (FINE_SIZE - 1)) && x1 + FINE_SIZE <= x2 && isRowCovered(m_fine[x1 >> FINE_SHIFT], y))
+        {
+            x1 += FINE_SIZE;
+        }
+        else if (isCovered(x1, y))
+        {
+            ++x1;
+        }
+        else
+        {
+            return x1;
+        }
+    }
+
+    return x2;
+}
+
+bool CoverageBuffer::isHidden(int x1, const int x2, const int y1, const int y2, const Sint32 depth) const
+{
+    SDL_assert(x1 >= 0 && x2 <= width());
+
+    if (y1 >= y2)
+    {
+        return true;
+    }
+
+    while (x1 < x2)
+    {
+        if (0 == (x1 & (COARSE_SIZE - 1)) && x1 + COARSE_SIZE <= x2 && isHidden(m_coarse[x1 >> COARSE_SHIFT], y1, y2, depth))
+        {
+            x1 += COARSE_SIZE;
+        }
+        else if (0 == (x1 & (FINE_SIZE - 1)) && x1 + FINE_SIZE <= x2 && isHidden(m_fine[x1 >> FINE_SHIFT], y1, y2, depth))
+        {
+            x1 += FINE_SIZE;
+        }
+        else if (y1 >= m_y1[x1] && y2 <= m_y2[x1] && depth >= m_depth[x1])
+        {
+            ++x1;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// ===========================================================================
+
+
+void BenchmarkCoverage()
+{
+    static const int WIDTH  = 1920;
+    static const int HEIGHT = 1080;
+
+    static const int RECTANGLE_COUNT = 4096;
+
+    // Minimal measurement time for each test, in seconds
+    static const Double MEASURE_TIME = 0.25;
+
+    // Walls of random lengths and depths, with holes between them
+    CoverageBuffer coverage;
+    coverage.resize(WIDTH);
+
+    for (int x = 0; x < WIDTH; )
+    {
+        const int length = std::min(1 + rand() % 256, WIDTH - x);
+        const bool hole  = 0 == rand() % 8;
+
+        const int height = HEIGHT / 8 + rand() % (HEIGHT * 7 / 8);
+        const Sint32 depth = (1 + rand() % 32) << 16;
+
+        for (int i = 0; i < length; ++i)
+        {
+            const Sint16 y1 = hole ? Sint16(HEIGHT / 2) : Sint16((HEIGHT - height) / 2);
+            const Sint16 y2 = hole ? Sint16(HEIGHT / 2) : Sint16(y1 + height);
+
+            coverage.setColumn(x + i, y1, y2, depth);
+        }
+
+        x += length;
+    }
+
+    coverage.updateGroups(0, WIDTH);
+
+    // Sprites of random sizes, mostly far away as in object-heavy scenes
+    std::vector<TestRectangle> rectangles(RECTANGLE_COUNT);
+
+    OC_FOREACH(TestRectangle& rectangle, rectangles)
+    {
+        const int width  = 1 + rand() % 256;
+        const int height = 1 + rand() % 256;
+
+        rectangle.x1    = rand() % (WIDTH - width);
+        rectangle.x2    = rectangle.x1 + width;
+        rectangle.y1    = HEIGHT / 2 - height / 2 + rand() % 64 - 32;
+        rectangle.y2    = rectangle.y1 + height;
+        rectangle.depth = (1 + rand() % 48) << 16;
+    }
+
+    const Double frequency = Double(SDL_GetPerformanceFrequency());
+
+    SDL_Log("Coverage buffer benchmark, %ix%i, %i rectangles", WIDTH, HEIGHT, RECTANGLE_COUNT);
+
+    int referenceHidden = -1;
+
+    for (int hierarchical = 0; hierarchical < 2; ++hierarchical)
+    {
+        const Uint64 start = SDL_GetPerformanceCounter();
+        Uint64 now = start;
+        int runs = 0;
+        int hidden = 0;
+
+        do
+        {
+            hidden = 0;
+
+            OC_FOREACH(const TestRectangle& rectangle, rectangles)
+            {
+                bool result;
+
+                if (0 != hierarchical)
+                {
+                    result = coverage.isHidden(rectangle.x1, rectangle.x2, rectangle.y1, rectangle.y2, rectangle.depth);
+                }
+                else
+                {
+                    // Reference test reads every column
+                    result = true;
+
+                    for (int x = rectangle.x1; x < rectangle.x2 && result; ++x)
+                    {
+                        result = coverage.isHidden(x, x + 1, rectangle.y1, rectangle.y2, rectangle.depth);
+                    }
+                }
+
+                hidden += result ? 1 : 0;
+            }
+
+            ++runs;
+            now = SDL_GetPerformanceCounter();
+        }
+        while ((now - start) / frequency < MEASURE_TIME);
+
+        const Double seconds = (now - start) / frequency / runs;
+
+        SDL_Log("  %-12s %8.3f ms, %i hidden", 0 != hierarchical ? "hierarchical" : "per column",
+            seconds * 1000.0, hidden);
+
+        if (0 == hierarchical)
+        {
+            referenceHidden = hidden;
+        }
+        else if (hidden != referenceHidden)
+        {
+            DoHalt("Hierarchical coverage test differs from per column one.");
+        }
+    }
+}
+
+} // namespace OC
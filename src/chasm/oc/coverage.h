@@ -0,0 +1,99 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_COVERAGE_H_INCLUDED
+#define OPENCHASM_OC_COVERAGE_H_INCLUDED
+
+#include "oc/types.h"
+
+namespace OC
+{
+
+// Rows covered by the nearest wall in every view column, with its depth
+// Rows outside of covered interval are open, so floor, ceiling and farther objects may show there
+// Groups of 8 and 64 columns keep rows and depth covered in all of their columns,
+// so fully hidden sprites and spans are rejected without reading every column
+
+class CoverageBuffer
+{
+public:
+    // Group sizes, parallel updates must be aligned to coarse group
+    static const int FINE_SHIFT   = 3;
+    static const int COARSE_SHIFT = 6;
+
+    CoverageBuffer();
+
+    int width() const { return int(m_y1.size()); }
+
+    // All columns become open
+    void resize(const int width);
+
+    // Groups are not updated until updateGroups() is called
+    void setColumn(const int x, const Sint16 y1, const Sint16 y2, const Sint32 depth);
+    void updateGroups(const int x1, const int x2);
+
+    bool isCovered(const int x, const int y) const
+    {
+        return y >= m_y1[x] && y < m_y2[x];
+    }
+
+    // First column from x1 to x2 with open row y, x2 when there is no such column
+    int findOpen(int x1, const int x2, const int y) const;
+
+    // Checks whether rectangle at given depth, 16.16 fixed point, is behind walls in all columns
+    bool isHidden(int x1, const int x2, const int y1, const int y2, const Sint32 depth) const;
+
+private:
+    // Intersection of covered rows and the farthest depth of group
+    struct Group
+    {
+        Sint16 y1;
+        Sint16 y2;
+        Sint32 depth;
+    };
+
+    std::vector<Sint16> m_y1;
+    std::vector<Sint16> m_y2;
+    std::vector<Sint32> m_depth;
+
+    std::vector<Group> m_fine;
+    std::vector<Group> m_coarse;
+
+    static bool isRowCovered(const Group& group, const int y)
+    {
+        return y >= group.y1 && y < group.y2;
+    }
+
+    static bool isHidden(const Group& group, const int y1, const int y2, const Sint32 depth)
+    {
+        return y1 >= group.y1 && y2 <= group.y2 && depth >= group.depth;
+    }
+
+    static void merge(Group& group, const Sint16 y1, const Sint16 y2, const Sint32 depth);
+};
+
+
+// Measures rejection of hidden rectangles and checks it against per column test
+void BenchmarkCoverage();
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_COVERAGE_H_INCLUDED
@@ -0,0 +1,157 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/governor.h"
+
+namespace OC
+{
+
+namespace
+{
+
+// Weight of the last frame in average frame time
+const Double AVERAGE_WEIGHT = 0.1;
+
+// Level is lowered if average frame time exceeds target by 10%,
+// and may be raised if it is 30% below target
+const Double SLOW_THRESHOLD = 1.1;
+const Double FAST_THRESHOLD = 0.7;
+
+const Uint32 SLOW_FRAMES   = 15;
+const Uint32 SETTLE_FRAMES = 30;
+
+const Uint32 MIN_RAISE_FRAMES = 120;
+const Uint32 MAX_RAISE_FRAMES = 1920;
+
+} // unnamed namespace
+
+
+QualityGovernor::QualityGovernor(const int levelCount)
+: m_levelCount(levelCount)
+, m_level(0)
+, m_target(0.0)
+, m_average(0.0)
+, m_slowFrames(0)
+, m_fastFrames(0)
+, m_settleFrames(0)
+, m_raiseFrames(MIN_RAISE_FRAMES)
+, m_raised(false)
+{
+    SDL_assert(levelCount > 0);
+}
+
+void QualityGovernor::setTarget(const Double milliseconds)
+{
+    m_target = std::max(milliseconds, 0.0);
+
+    reset();
+}
+
+bool QualityGovernor::update(const Double milliseconds)
+{
+    if (!isEnabled())
+    {
+        return false;
+    }
+
+    m_average = 0.0 == m_average
+        ? milliseconds
+        : m_average + (milliseconds - m_average) * AVERAGE_WEIGHT;
+
+    if (m_settleFrames > 0)
+    {
+        --m_settleFrames;
+        return false;
+    }
+
+    if (m_average > m_target * SLOW_THRESHOLD)
+    {
+        m_fastFrames = 0;
+
+        if (++m_slowFrames >= SLOW_FRAMES && m_level + 1 < m_levelCount)
+        {
+            // Raised level turned out to be too slow, be more careful next time
+            if (m_raised)
+            {
+                m_raiseFrames = std::min(m_raiseFrames * 2, MAX_RAISE_FRAMES);
+            }
+
+            changeLevel(m_level + 1);
+            m_raised = false;
+
+            return true;
+        }
+    }
+    else if (m_average < m_target * FAST_THRESHOLD)
+    {
+        m_slowFrames = 0;
+
+        if (++m_fastFrames >= m_raiseFrames && m_level > 0)
+        {
+            changeLevel(m_level - 1);
+            m_raised = true;
+
+            return true;
+        }
+    }
+    else
+    {
+        m_slowFrames = 0;
+        m_fastFrames = 0;
+
+        // Raised level is sustainable
+        if (m_raised)
+        {
+            m_raiseFrames = std::max(m_raiseFrames / 2, MIN_RAISE_FRAMES);
+            m_raised = false;
+        }
+    }
+
+    return false;
+}
+
+void QualityGovernor::reset()
+{
+    m_level   = 0;
+    m_average = 0.0;
+
+    m_slowFrames   = 0;
+    m_fastFrames   = 0;
+    m_settleFrames = 0;
+    m_raiseFrames  = MIN_RAISE_FRAMES;
+    m_raised       = false;
+}
+
+void QualityGovernor::changeLevel(const int level)
+{
+    SDL_assert(level >= 0 && level < m_levelCount);
+
+    m_level = level;
+
+    m_slowFrames   = 0;
+    m_fastFrames   = 0;
+    m_settleFrames = SETTLE_FRAMES;
+
+    // Frame time of previous level is meaningless now
+    m_average = 0.0;
+}
+
+} // namespace OC
@@ -0,0 +1,80 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_GOVERNOR_H_INCLUDED
+#define OPENCHASM_OC_GOVERNOR_H_INCLUDED
+
+#include "oc/types.h"
+
+namespace OC
+{
+
+// Chooses quality level keeping average frame time within target
+// Level zero is the best quality, higher levels are cheaper to render
+// Level is lowered quickly when frames are too slow, and raised back
+// only after long period of fast frames, so it does not oscillate
+
+class QualityGovernor
+{
+public:
+    explicit QualityGovernor(const int levelCount);
+
+    // Target frame time in milliseconds, zero disables governor
+    void setTarget(const Double milliseconds);
+    Double target() const { return m_target; }
+
+    bool isEnabled() const { return m_target > 0.0; }
+
+    int level() const { return m_level; }
+    int levelCount() const { return m_levelCount; }
+
+    Double averageFrameTime() const { return m_average; }
+
+    // Takes time of the last frame, returns true if level was changed
+    bool update(const Double milliseconds);
+
+    // Returns to the best quality and forgets measurements
+    void reset();
+
+private:
+    int m_levelCount;
+    int m_level;
+
+    Double m_target;
+    Double m_average;
+
+    // Number of consecutive frames above or below thresholds
+    Uint32 m_slowFrames;
+    Uint32 m_fastFrames;
+
+    // Frames to skip after level change, new level needs time to settle
+    Uint32 m_settleFrames;
+
+    // Fast frames required to raise level, doubled when raised level was too slow
+    Uint32 m_raiseFrames;
+    bool m_raised;
+
+    void changeLevel(const int level);
+};
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_GOVERNOR_H_INCLUDED
@@ -29,6 +29,8 @@ namespace OC
 
 Bitmap::Bitmap()
 : m_internal(NULL)
+, m_centerX(0)
+, m_columnLength(0)
 {
 
 }
@@ -52,7 +54,22 @@ const Uint16 Bitmap::centeX() const
 {
     SDL_assert(isValid());
 
-    return Uint16(reinterpret_cast<size_t>(m_internal->userdata));
+    return m_centerX;
+}
+
+const Uint16 Bitmap::columnLength() const
+{
+    SDL_assert(isValid());
+
+    return m_columnLength;
+}
+
+
+const int Bitmap::pitch() const
+{
+    SDL_assert(isValid());
+
+    return m_internal->pitch;
 }
 
 
@@ -63,6 +80,13 @@ const Uint8* Bitmap::pixels() const
     return static_cast<const Uint8*>(m_internal->pixels);
 }
 
+Uint8* Bitmap::pixels()
+{
+    SDL_assert(isValid());
+
+    return static_cast<Uint8*>(m_internal->pixels);
+}
+
 const Uint8 Bitmap::pixel(const Uint16 x, const Uint16 y) const
 {
     SDL_assert(x >= 0);
@@ -83,15 +107,53 @@ void Bitmap::setPixel(const Uint16 x, const Uint16 y, const Uint8 value)
 }
 
 
-void Bitmap::create(const int width, const int height)
+void Bitmap::create(const int width, const int height, const ScopeType scope)
 {
     SDL_assert(width  > 0);
     SDL_assert(height > 0);
 
     release();
 
-    m_internal = BitmapManager::instance().createSurface(width, height);
+    m_internal = BitmapManager::instance().createSurface(width, height, scope);
     SDL_assert(NULL != m_internal);
+
+    m_centerX = 0;
+    m_columnLength = 0;
+}
+
+void Bitmap::createColumnMajor(const Bitmap& source, const ScopeType scope)
+{
+    SDL_assert(source.isValid());
+    SDL_assert(this != &source);
+
+    const int width  = source.width();
+    const int height = source.height();
+
+    int columnLength = 1;
+
+    while (columnLength < height)
+    {
+        columnLength *= 2;
+    }
+
+    create(columnLength, width, scope);
+    m_centerX = source.m_centerX;
+    m_columnLength = Uint16(height);
+
+    const Uint8* const sourcePixels = source.pixels();
+    const int sourcePitch = source.pitch();
+
+    Uint8* column = static_cast<Uint8*>(m_internal->pixels);
+
+    for (int x = 0; x < width; ++x)
+    {
+        for (int y = 0; y < columnLength; ++y)
+        {
+            column[y] = sourcePixels[(y % height) * sourcePitch + x];
+        }
+
+        column += m_internal->pitch;
+    }
 }
 
 void Bitmap::release()
@@ -105,18 +167,26 @@ void Bitmap::release()
 }
 
 
-void Bitmap::load(const Path& path)
+void Bitmap::load(const Path& path, const ScopeType scope)
 {
     BinaryResource celFile(path);
-    load(celFile, FORMAT_CEL);
+    load(celFile, FORMAT_CEL, scope);
+}
+
+void Bitmap::load(BinaryInputStream& stream, const ScopeType scope)
+{
+    load(stream, FORMAT_PIC, scope);
 }
 
-void Bitmap::load(BinaryInputStream& stream)
+void Bitmap::load(BinaryInputStream& stream, const Uint16 width, const Uint16 height, const ScopeType scope)
 {
-    load(stream, FORMAT_PIC);
+    SDL_assert(stream.good());
+
+    create(width, height, scope);
+    readPixels(stream);
 }
 
-void Bitmap::load(BinaryInputStream& stream, const FormatType format)
+void Bitmap::load(BinaryInputStream& stream, const FormatType format, const ScopeType scope)
 {
     SDL_assert(stream.good());
 
@@ -133,26 +203,34 @@ void Bitmap::load(BinaryInputStream& stream, const FormatType format)
     stream >> height;
     stream >> centerX;
 
-    create(width, height);
+    create(width, height, scope);
 
-    // No other data are stored at the moment
-    // So treat userdata pointer as centerX value
-    m_internal->userdata = reinterpret_cast<void*>(centerX);
+    m_centerX = centerX;
 
     if (FORMAT_CEL == format)
     {
         stream.seekg(0x320); // skip header and pallete
     }
 
+    readPixels(stream);
+}
+
+void Bitmap::readPixels(BinaryInputStream& stream)
+{
+    SDL_assert(isValid());
+
     char* const pixelData = static_cast<char*>(m_internal->pixels);
 
-    if (m_internal->w == m_internal->pitch)
+    const int width  = m_internal->w;
+    const int height = m_internal->h;
+
+    if (width == m_internal->pitch)
     {
         stream.read(pixelData, width * height);
     }
     else
     {
-        for (Uint16 i = 0; i < height; ++i)
+        for (int i = 0; i < height; ++i)
         {
             stream.read(pixelData + i * m_internal->pitch, width);
         }
@@ -198,11 +276,42 @@ bool Bitmap::saveAsBMP(const char* const path)
 // ===========================================================================
 
 
+namespace
+{
+
+// Enough for sprites, sky and 3D objects textures of a typical level
+// Arena grows if level requires more
+const size_t LEVEL_ARENA_SLAB_SIZE = 4 * 1024 * 1024;
+
+} // unnamed namespace
+
+
+const Uint32 BitmapManager::NO_ENTRY;
+
+
+BitmapManager::Counters::Counters()
+: surfaces(0)
+, bytes(0)
+{
+}
+
+
 BitmapManager::BitmapManager()
-: m_contrast(12)
+: m_freeEntry(NO_ENTRY)
+, m_levelArena(LEVEL_ARENA_SLAB_SIZE)
+, m_contrast(12)
 , m_brightness(7)
 , m_color(9)
 {
+    m_scopeEntries.fill(NO_ENTRY);
+
+    m_palette = SDL_AllocPalette(int(Palette::size()));
+
+    if (NULL == m_palette)
+    {
+        DoHaltSDLError("Failed to create palette.");
+    }
+
     BinaryResource paletteFile("common/chasm2.pal");
     paletteFile.readArray(m_original);
 
@@ -211,25 +320,37 @@ BitmapManager::BitmapManager()
 
 BitmapManager::~BitmapManager()
 {
-    OC_FOREACH(SDL_Surface* surface, m_surfaces)
-    {
-        SDL_FreeSurface(surface);
-    }
+    releaseScope(Bitmap::SCOPE_GLOBAL);
+    releaseLevel();
+
+    SDL_FreePalette(m_palette);
 }
 
 
-SDL_Surface* BitmapManager::createSurface(const int width, const int height)
+SDL_Surface* BitmapManager::createSurface(const int width, const int height, const Bitmap::ScopeType scope)
 {
-    SDL_Surface* const result = SDL_CreateRGBSurface(0, width, height, 8, 0, 0, 0, 0);
+    SDL_Surface* result = NULL;
+
+    if (Bitmap::SCOPE_LEVEL == scope)
+    {
+        // Surface doesn't own preallocated pixels, SDL_FreeSurface() leaves them intact
+        void* const pixels = m_levelArena.allocate(width * height);
+        result = SDL_CreateRGBSurfaceFrom(pixels, width, height, 8, width, 0, 0, 0, 0);
+    }
+    else
+    {
+        result = SDL_CreateRGBSurface(0, width, height, 8, 0, 0, 0, 0);
+    }
 
     if (NULL == result)
     {
         DoHaltSDLError("Failed to create render surface.");
     }
 
-    m_surfaces.push_back(result);
+    result->userdata = reinterpret_cast<void*>(size_t(registerSurface(result, scope)));
 
-    applyPalette(result);
+    // Surface's own palette is released, shared one is referenced instead
+    SDL_SetSurfacePalette(result, m_palette);
 
     return result;
 }
@@ -238,14 +359,108 @@ void BitmapManager::releaseSurface(SDL_Surface* const surface)
 {
     SDL_assert(NULL != surface);
 
-    const SurfaceList::iterator it = std::find(m_surfaces.begin(), m_surfaces.end(), surface);
-    SDL_assert(m_surfaces.end() != it);
-
-    m_surfaces.erase(it);
+    // Level-scoped surface may be released individually too
+    // but its pixel data stay in arena until the level is released
+    unregisterSurface(Uint32(reinterpret_cast<size_t>(surface->userdata)));
 
     SDL_FreeSurface(surface);
 }
 
+void BitmapManager::releaseLevel()
+{
+    releaseScope(Bitmap::SCOPE_LEVEL);
+
+    m_levelArena.reset();
+}
+
+
+Uint32 BitmapManager::registerSurface(SDL_Surface* const surface, const Bitmap::ScopeType scope)
+{
+    Uint32 index = m_freeEntry;
+
+    if (NO_ENTRY == index)
+    {
+        index = Uint32(m_entries.size());
+        m_entries.push_back(Entry());
+    }
+    else
+    {
+        m_freeEntry = m_entries[index].next;
+    }
+
+    Entry& entry = m_entries[index];
+    entry.surface  = surface;
+    entry.scope    = scope;
+    entry.category = MemoryStats::bitmapCategory();
+    entry.prev     = NO_ENTRY;
+    entry.next    = m_scopeEntries[scope];
+
+    if (NO_ENTRY != entry.next)
+    {
+        m_entries[entry.next].prev = index;
+    }
+
+    m_scopeEntries[scope] = index;
+
+    const size_t bytes = surface->pitch * surface->h;
+
+    Counters& counters = m_counters[scope];
+    ++counters.surfaces;
+    counters.bytes += bytes;
+
+    MemoryStats::allocate(entry.category, bytes);
+
+    return index;
+}
+
+void BitmapManager::unregisterSurface(const Uint32 index)
+{
+    SDL_assert(index < m_entries.size());
+
+    Entry& entry = m_entries[index];
+    SDL_assert(NULL != entry.surface);
+
+    if (NO_ENTRY == entry.prev)
+    {
+        m_scopeEntries[entry.scope] = entry.next;
+    }
+    else
+    {
+        m_entries[entry.prev].next = entry.next;
+    }
+
+    if (NO_ENTRY != entry.next)
+    {
+        m_entries[entry.next].prev = entry.prev;
+    }
+
+    const size_t bytes = entry.surface->pitch * entry.surface->h;
+
+    Counters& counters = m_counters[entry.scope];
+    --counters.surfaces;
+    counters.bytes -= bytes;
+
+    MemoryStats::release(entry.category, bytes);
+
+    entry.surface = NULL;
+    entry.next    = m_freeEntry;
+
+    m_freeEntry = index;
+}
+
+void BitmapManager::releaseScope(const Bitmap::ScopeType scope)
+{
+    while (NO_ENTRY != m_scopeEntries[scope])
+    {
+        const Uint32 index = m_scopeEntries[scope];
+        SDL_Surface* const surface = m_entries[index].surface;
+
+        unregisterSurface(index);
+
+        SDL_FreeSurface(surface);
+    }
+}
+
 
 void BitmapManager::setContrast(const Sint16 contrast)
 {
@@ -269,9 +484,9 @@ void BitmapManager::setPaletteParameters(const Sint16 contrast, const Sint16 col
     m_brightness = brightness;
 
     // Apply parameters on palette
-    m_current    = m_original;
+    m_adjusted   = m_original;
 
-    OC_FOREACH(SDL_Color& color, m_current)
+    OC_FOREACH(SDL_Color& color, m_adjusted)
     {
         const Uint8 coeff = std::max(std::max(color.r, color.g), color.b);
         color.r = applyContast(color.r, coeff);
@@ -279,7 +494,7 @@ void BitmapManager::setPaletteParameters(const Sint16 contrast, const Sint16 col
         color.b = applyContast(color.b, coeff);
     }
 
-    OC_FOREACH(SDL_Color& color, m_current)
+    OC_FOREACH(SDL_Color& color, m_adjusted)
     {
         const Sint16 coeff = (Sint16(color.r) + Sint16(color.g) + Sint16(color.b)) / 3;
         color.r = applyColor(color.r, coeff);
@@ -287,7 +502,7 @@ void BitmapManager::setPaletteParameters(const Sint16 contrast, const Sint16 col
         color.b = applyColor(color.b, coeff);
     }
 
-    OC_FOREACH(SDL_Color& color, m_current)
+    OC_FOREACH(SDL_Color& color, m_adjusted)
     {
         const Sint16 coeff = std::max(std::max(color.r, color.g), color.b);
         color.r = applyBrightness(color.r, coeff);
@@ -295,19 +510,7 @@ void BitmapManager::setPaletteParameters(const Sint16 contrast, const Sint16 col
         color.b = applyBrightness(color.b, coeff);
     }
 
-    // Convert 64-color palette to 256-color
-    OC_FOREACH(SDL_Color& color, m_current)
-    {
-        color.r = color.r * 4;
-        color.g = color.g * 4;
-        color.b = color.b * 4;
-    }
-
-    // Update palettes of registred surfaces
-    OC_FOREACH(SDL_Surface* const surface, m_surfaces)
-    {
-        applyPalette(surface);
-    }
+    updatePalette();
 }
 
 
@@ -344,29 +547,132 @@ Uint8 BitmapManager::applyBrightness(const Uint8 color, const Sint16 coeff) cons
 }
 
 
-void BitmapManager::applyPalette(SDL_Surface* const surface) const
+void BitmapManager::updatePalette()
 {
-    SDL_assert(NULL != surface);
-    SDL_assert(NULL != surface->format);
-    SDL_assert(NULL != surface->format->palette);
-    
-    SDL_SetPaletteColors(surface->format->palette, &m_current[0], 0, int(Palette::size()));
+    m_current = m_adjusted;
+
+    // Convert 64-color palette to 256-color
+    OC_FOREACH(SDL_Color& color, m_current)
+    {
+        color.r = color.r * 4;
+        color.g = color.g * 4;
+        color.b = color.b * 4;
+    }
+
+    // Palette version is changed, so blit mappings of all surfaces are updated lazily
+    SDL_SetPaletteColors(m_palette, &m_current[0], 0, int(Palette::size()));
 }
 
 
 // ===========================================================================
 
 
+namespace
+{
+
+// More rectangles are merged into one bounding rectangle
+const size_t MAX_DIRTY_RECTS = 32;
+
+bool Contains(const SDL_Rect& outer, const SDL_Rect& inner)
+{
+    return inner.x >= outer.x && inner.x + inner.w <= outer.x + outer.w
+        && inner.y >= outer.y && inner.y + inner.h <= outer.y + outer.h;
+}
+
+template <typename RectList>
+void AddRect(RectList& list, const Rect& rect)
+{
+    for (size_t i = 0; i < list.size(); /* EMPTY */)
+    {
+        if (Contains(list[i], rect))
+        {
+            return;
+        }
+
+        if (Contains(rect, list[i]))
+        {
+            list[i] = list.back();
+            list.pop_back();
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    if (list.size() < MAX_DIRTY_RECTS)
+    {
+        list.push_back(rect);
+        return;
+    }
+
+    Rect bounds = rect;
+
+    for (size_t i = 0; i < list.size(); ++i)
+    {
+        SDL_UnionRect(&bounds, &list[i], &bounds);
+    }
+
+    list.assign(1, bounds);
+}
+
+template <typename RectList>
+void AddRects(RectList& list, const RectList& rects)
+{
+    for (size_t i = 0; i < rects.size(); ++i)
+    {
+        AddRect(list, rects[i]);
+    }
+}
+
+} // unnamed namespace
+
+
 Renderer::Renderer()
-: m_window  (NULL)
+: m_backend (BACKEND_WINDOW)
+, m_window  (NULL)
 , m_renderer(NULL)
+, m_texture (NULL)
+, m_scaleFilter(SCALE_NEAREST)
+, m_windowScale(1)
+, m_scale(1)
+, m_backgroundTile(NULL)
+, m_frameCount(0)
+, m_frameDumpInterval(0)
+, m_paletteVersion(0)
+, m_fadeFrom(64)
+, m_fadeTo  (64)
+, m_fadeStart   (0)
+, m_fadeDuration(0)
+, m_lutFade(64)
+, m_writeFrame  (0)
+, m_readyFrame  (1)
+, m_convertFrame(2)
+, m_thread   (NULL)
+, m_mutex    (SDL_CreateMutex())
+, m_condition(SDL_CreateCond())
+, m_frameReady(false)
+, m_converting(false)
+, m_threadQuit(false)
+, m_uploadPending(false)
+, m_presentInterval(0)
+, m_lastPresent(0)
 {
+    if (NULL == m_mutex || NULL == m_condition)
+    {
+        DoHaltSDLError("Failed to create conversion thread synchronization objects.");
+    }
 
+    m_tint.fill(0);
+    m_lutTint.fill(0);
 }
 
 Renderer::~Renderer()
 {
     release();
+
+    SDL_DestroyCond(m_condition);
+    SDL_DestroyMutex(m_mutex);
 }
 
 const Uint16 Renderer::screenWidth() const
@@ -379,58 +685,600 @@ const Uint16 Renderer::screenHeight() const
     return m_screen.height();
 }
 
+void Renderer::setBackend(const Backend backend)
+{
+    m_backend = backend;
+}
+
+void Renderer::setFrameDumpInterval(const Uint32 interval)
+{
+    m_frameDumpInterval = interval;
+}
+
+void Renderer::setTint(const Sint16 red, const Sint16 green, const Sint16 blue)
+{
+    m_tint[0] = Clamp(Sint16(0), red,   Sint16(64));
+    m_tint[1] = Clamp(Sint16(0), green, Sint16(64));
+    m_tint[2] = Clamp(Sint16(0), blue,  Sint16(64));
+}
+
+void Renderer::fade(const Sint16 level, const Uint32 duration)
+{
+    m_fadeFrom     = fadeLevel();
+    m_fadeTo       = Clamp(Sint16(0), level, Sint16(64));
+    m_fadeStart    = SDL_GetTicks();
+    m_fadeDuration = duration;
+}
+
+bool Renderer::isFading() const
+{
+    return fadeLevel() != m_fadeTo;
+}
+
+Sint16 Renderer::fadeLevel() const
+{
+    const Uint32 elapsed = SDL_GetTicks() - m_fadeStart;
+
+    if (elapsed >= m_fadeDuration)
+    {
+        return m_fadeTo;
+    }
+
+    return Sint16(m_fadeFrom + (m_fadeTo - m_fadeFrom) * Sint32(elapsed) / Sint32(m_fadeDuration));
+}
+
+
+void Renderer::setScaleFilter(const ScaleFilter filter)
+{
+    m_scaleFilter = filter;
+}
+
+void Renderer::setWindowScale(const int scale)
+{
+    m_windowScale = std::max(1, std::min(scale, MAX_SCALE_FACTOR));
+}
+
+
 void Renderer::setVideoMode(const Uint16 width, const Uint16 height)
 {
-    release();
+    // Window is kept on mode change, upscaling adapts to its size
+    stopConvertThread();
+
+    m_screen.create(width, height);
 
-    m_window = SDL_CreateWindow("OpenChasm", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED, width, height, SDL_WINDOW_SHOWN);
+    if (NULL != m_backgroundTile)
+    {
+        buildBackground();
+    }
+
+    // Force palette conversion on the first frame
+    m_paletteVersion = 0;
+
+    m_dirty.clear();
+    invalidate();
+
+    if (BACKEND_HEADLESS == m_backend)
+    {
+        m_frame.resize(size_t(width) * height);
+        return;
+    }
 
     if (NULL == m_window)
     {
-        DoHaltSDLError("Failed to create window.");
+        // Window is created on main thread because it receives events
+        m_window = SDL_CreateWindow("OpenChasm", SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            width * m_windowScale, height * m_windowScale, SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_ALLOW_HIGHDPI);
+
+        if (NULL == m_window)
+        {
+            DoHaltSDLError("Failed to create window.");
+        }
+
+        // Renderer is created and used on the thread which owns the window
+        // No vertical sync, presents are paced by display refresh rate instead,
+        // so game thread never waits in SDL_RenderPresent()
+        m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED);
+
+        if (NULL == m_renderer)
+        {
+            DoHaltSDLError("Failed to create renderer.");
+        }
+
+        SDL_DisplayMode mode;
+        const int refreshRate = 0 == SDL_GetCurrentDisplayMode(SDL_GetWindowDisplayIndex(m_window), &mode)
+            && mode.refresh_rate > 0 ? mode.refresh_rate : 60;
+
+        m_presentInterval = SDL_GetPerformanceFrequency() / Uint64(refreshRate);
     }
+    else
+    {
+        int windowWidth;
+        int windowHeight;
+        SDL_GetWindowSize(m_window, &windowWidth, &windowHeight);
 
-    m_renderer = SDL_CreateRenderer(m_window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        // Grow window if new mode does not fit in it
+        if (windowWidth < width || windowHeight < height)
+        {
+            SDL_SetWindowSize(m_window, std::max<int>(windowWidth, width), std::max<int>(windowHeight, height));
+        }
+    }
 
-    if (NULL == m_renderer)
+    for (size_t i = 0; i < m_frames.size(); ++i)
     {
-        DoHaltSDLError("Failed to create renderer.");
+        m_frames[i].pixels.assign(size_t(width) * height, 0);
+        m_frames[i].lut.fill(0xFF000000);
+        m_frames[i].changed.clear();
+        m_frames[i].outdated.clear();
     }
 
-    m_screen.create(width, height);
+    m_convertedRects.clear();
+    m_uploadPending = false;
+    m_lastPresent   = 0;
 
-    SDL_RenderClear(m_renderer);
+    // Texture of new size is needed
+    m_scale = 0;
+    updateScale();
+
+    startConvertThread();
 }
 
 
 void Renderer::draw(const Bitmap& image, const int x, const int y, const Rect& clip)
 {
     image.draw(m_screen, x, y, clip);
+
+    invalidate(Rect(x, y,
+        -1 == clip.w ? image.width()  : clip.w,
+        -1 == clip.h ? image.height() : clip.h));
+}
+
+void Renderer::invalidate(const Rect& area)
+{
+    const Rect screen(0, 0, m_screen.width(), m_screen.height());
+    Rect clipped;
+
+    if (SDL_IntersectRect(&area, &screen, &clipped))
+    {
+        AddRect(m_dirty, clipped);
+    }
+}
+
+void Renderer::invalidate()
+{
+    m_dirty.assign(1, Rect(0, 0, m_screen.width(), m_screen.height()));
+}
+
+bool Renderer::hasChanges() const
+{
+    const SDL_Palette* const palette = BitmapManager::instance().palette();
+
+    return !m_dirty.empty() || isFading() || m_uploadPending
+        || palette->version != m_paletteVersion || m_tint != m_lutTint;
+}
+
+
+void Renderer::setBackground(const Bitmap& tile)
+{
+    if (&tile == m_backgroundTile && m_background.isValid())
+    {
+        return;
+    }
+
+    m_backgroundTile = &tile;
+
+    buildBackground();
+}
+
+void Renderer::drawBackground(const Rect& area)
+{
+    SDL_assert(m_background.isValid());
+
+    const Rect source = -1 == area.w ? Rect(0, 0, m_screen.width(), m_screen.height()) : area;
+
+    draw(m_background, source.x, source.y, source);
+}
+
+void Renderer::buildBackground()
+{
+    SDL_assert(NULL != m_backgroundTile);
+
+    const Uint16 screenWidth  = m_screen.width();
+    const Uint16 screenHeight = m_screen.height();
+
+    const Uint16 tileWidth  = m_backgroundTile->width();
+    const Uint16 tileHeight = m_backgroundTile->height();
+
+    m_background.create(screenWidth, screenHeight);
+
+    for (Uint16 y = 0; y < screenHeight; y += tileHeight)
+    {
+        for (Uint16 x = 0; x < screenWidth; x += tileWidth)
+        {
+            m_backgroundTile->draw(m_background, x, y);
+        }
+    }
 }
 
 
 void Renderer::present()
 {
-    SDL_Texture* const blitTexture = m_screen.createTexture(m_renderer);
+    // New palette or effects change every pixel
+    if (updatePaletteLUT())
+    {
+        invalidate();
+    }
 
-    SDL_RenderCopy(m_renderer, blitTexture, NULL, NULL);
-    SDL_RenderPresent(m_renderer);
+    ++m_frameCount;
+
+    if (0 != m_frameDumpInterval && 0 == m_frameCount % m_frameDumpInterval)
+    {
+        dumpFrame();
+    }
+
+    const Uint16 width  = m_screen.width();
+
+    if (BACKEND_HEADLESS == m_backend)
+    {
+        // Same conversion as for texture to keep timings comparable
+        OC_FOREACH(const Rect& rect, m_dirty)
+        {
+            ExpandPixels(&m_frame[rect.y * width + rect.x], width * int(sizeof(Uint32)),
+                m_screen.pixels() + rect.y * m_screen.pitch() + rect.x, m_screen.pitch(),
+                rect.w, rect.h, &m_paletteLUT[0]);
+        }
+
+        m_dirty.clear();
+        return;
+    }
+
+    // Frame converted while game was rendering, if it's finished and display is ready for it
+    showConverted();
+
+    // Previous frame is still on screen
+    if (m_dirty.empty())
+    {
+        return;
+    }
+
+    // Every frame buffer misses these changes now
+    for (size_t i = 0; i < m_frames.size(); ++i)
+    {
+        AddRects(m_frames[i].outdated, m_dirty);
+    }
+
+    // Screen buffer is kept intact because game redraws changed parts only
+    Frame& frame = m_frames[m_writeFrame];
+
+    OC_FOREACH(const Rect& rect, frame.outdated)
+    {
+        for (int y = rect.y; y < rect.y + rect.h; ++y)
+        {
+            SDL_memcpy(&frame.pixels[y * width + rect.x], m_screen.pixels() + y * m_screen.pitch() + rect.x, rect.w);
+        }
+    }
+
+    frame.outdated.clear();
+    frame.changed.swap(m_dirty);
+    frame.lut = m_paletteLUT;
+
+    m_dirty.clear();
+
+    SDL_LockMutex(m_mutex);
+
+    // Frame not taken by conversion thread yet is dropped, but its changes are not
+    if (m_frameReady)
+    {
+        AddRects(frame.changed, m_frames[m_readyFrame].changed);
+    }
+
+    std::swap(m_writeFrame, m_readyFrame);
+    m_frameReady = true;
+
+    SDL_CondBroadcast(m_condition);
+    SDL_UnlockMutex(m_mutex);
+
+    m_uploadPending = true;
+}
+
+bool Renderer::updatePaletteLUT()
+{
+    // Palette version is increased by SDL on every change of its colors
+    const SDL_Palette* const palette = BitmapManager::instance().palette();
+
+    const Sint16 fade = fadeLevel();
+
+    if (palette->version == m_paletteVersion && m_tint == m_lutTint && fade == m_lutFade)
+    {
+        return false;
+    }
+
+    for (int i = 0; i < palette->ncolors; ++i)
+    {
+        const SDL_Color& color = palette->colors[i];
+
+        // Effects are applied in original [0..63] color range
+        Uint32 r = color.r / 4;
+        Uint32 g = color.g / 4;
+        Uint32 b = color.b / 4;
+
+        r += (63 - r) * m_tint[0] / 64;
+        g += (63 - g) * m_tint[1] / 64;
+        b += (63 - b) * m_tint[2] / 64;
+
+        r = r * fade / 64 * 4;
+        g = g * fade / 64 * 4;
+        b = b * fade / 64 * 4;
+
+        m_paletteLUT[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+
+    m_paletteVersion = palette->version;
+    m_lutTint = m_tint;
+    m_lutFade = fade;
+
+    return true;
+}
+
+void Renderer::dumpFrame()
+{
+    const Path path = FileSystem::instance().userPath((Format("frame%05u.bmp") % m_frameCount).str());
 
-    SDL_DestroyTexture(blitTexture);
+    if (!m_screen.saveAsBMP(path.string().c_str()))
+    {
+        SDL_Log("Failed to save frame to %s: %s", path.string().c_str(), SDL_GetError());
+    }
+}
+
+
+void Renderer::startConvertThread()
+{
+    SDL_assert(NULL == m_thread);
+
+    m_frameReady = false;
+    m_converting = false;
+    m_threadQuit = false;
+
+    m_thread = SDL_CreateThread(convertThread, "Convert", this);
+
+    if (NULL == m_thread)
+    {
+        DoHaltSDLError("Failed to create conversion thread.");
+    }
+}
+
+void Renderer::stopConvertThread()
+{
+    if (NULL == m_thread)
+    {
+        return;
+    }
+
+    SDL_LockMutex(m_mutex);
+    m_threadQuit = true;
+    SDL_CondBroadcast(m_condition);
+    SDL_UnlockMutex(m_mutex);
+
+    SDL_WaitThread(m_thread, NULL);
+    m_thread = NULL;
+}
+
+int SDLCALL Renderer::convertThread(void* data)
+{
+    static_cast<Renderer*>(data)->convertLoop();
+    return 0;
+}
+
+void Renderer::convertLoop()
+{
+    // No SDL video or renderer calls are made here, they belong to main thread
+    SDL_LockMutex(m_mutex);
+
+    for (;;)
+    {
+        // Converted image is kept until main thread uploads it to texture
+        while ((!m_frameReady || !m_convertedRects.empty()) && !m_threadQuit)
+        {
+            SDL_CondWait(m_condition, m_mutex);
+        }
+
+        if (m_threadQuit)
+        {
+            break;
+        }
+
+        std::swap(m_convertFrame, m_readyFrame);
+        m_frameReady = false;
+        m_converting = true;
+
+        SDL_UnlockMutex(m_mutex);
+
+        const Frame& frame = m_frames[m_convertFrame];
+
+        OC_FOREACH(const Rect& rect, frame.changed)
+        {
+            convertArea(frame, rect);
+        }
+
+        SDL_LockMutex(m_mutex);
+
+        AddRects(m_convertedRects, frame.changed);
+        m_converting = false;
+
+        SDL_CondBroadcast(m_condition);
+    }
+
+    SDL_UnlockMutex(m_mutex);
+}
+
+void Renderer::convertArea(const Frame& frame, const Rect& area)
+{
+    const int width  = m_screen.width();
+    const int height = m_screen.height();
+
+    const Uint8* pixels = &frame.pixels[area.y * width + area.x];
+    int pitch = width;
+
+    // Upscaling is done on 8-bit pixels, before palette expansion
+    if (m_scale > 1)
+    {
+        // EPX output depends on neighbour pixels, two of them for 4x
+        const int margin = SCALE_EPX == m_scaleFilter ? 2 : 0;
+
+        Rect source;
+        source.x = std::max(area.x - margin, 0);
+        source.y = std::max(area.y - margin, 0);
+        source.w = std::min(area.x + area.w + margin, width ) - source.x;
+        source.h = std::min(area.y + area.h + margin, height) - source.y;
+
+        pitch = source.w * m_scale;
+
+        ScalePixels(m_scaleFilter, m_scale, &m_scaled[0], pitch,
+            &frame.pixels[source.y * width + source.x], width, source.w, source.h);
+
+        pixels = &m_scaled[(area.y - source.y) * m_scale * pitch + (area.x - source.x) * m_scale];
+    }
+
+    const int convertedWidth = width * m_scale;
+
+    ExpandPixels(&m_converted[area.y * m_scale * convertedWidth + area.x * m_scale],
+        convertedWidth * int(sizeof(Uint32)), pixels, pitch, area.w * m_scale, area.h * m_scale, &frame.lut[0]);
+}
+
+
+void Renderer::updateScale()
+{
+    const Uint16 width  = m_screen.width();
+    const Uint16 height = m_screen.height();
+
+    int outputWidth;
+    int outputHeight;
+
+    if (0 != SDL_GetRendererOutputSize(m_renderer, &outputWidth, &outputHeight))
+    {
+        outputWidth  = width;
+        outputHeight = height;
+    }
+
+    const int scale = std::max(1, std::min(MAX_SCALE_FACTOR,
+        std::min(outputWidth / width, outputHeight / height)));
+
+    if (scale == m_scale)
+    {
+        return;
+    }
+
+    m_scale = scale;
+
+    if (NULL != m_texture)
+    {
+        SDL_DestroyTexture(m_texture);
+    }
+
+    m_texture = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_ARGB8888,
+        SDL_TEXTUREACCESS_STREAMING, width * scale, height * scale);
+
+    if (NULL == m_texture)
+    {
+        DoHaltSDLError("Failed to create screen texture.");
+    }
+
+    m_scaled.resize(1 == scale ? 0 : size_t(width) * height * scale * scale);
+    m_converted.assign(size_t(width) * height * scale * scale, 0xFF000000);
+
+    // Image converted with previous factor is useless, the whole screen is converted again
+    m_convertedRects.clear();
+    invalidate();
+}
+
+void Renderer::showConverted()
+{
+    // Conversion thread doesn't touch upscaled image and its size while mutex is held
+    SDL_LockMutex(m_mutex);
+
+    // Nothing is waited for, busy conversion thread or display not ready for the next image
+    // mean that converted image is shown by one of the following calls
+    if (m_converting)
+    {
+        SDL_UnlockMutex(m_mutex);
+        return;
+    }
+
+    // Window size may change, upscaling factor follows it
+    updateScale();
+
+    const Uint64 now = SDL_GetPerformanceCounter();
+
+    if (m_convertedRects.empty() || now - m_lastPresent < m_presentInterval)
+    {
+        SDL_UnlockMutex(m_mutex);
+        return;
+    }
+
+    const int pitch = m_screen.width() * m_scale;
+
+    OC_FOREACH(const Rect& rect, m_convertedRects)
+    {
+        const Rect target(rect.x * m_scale, rect.y * m_scale, rect.w * m_scale, rect.h * m_scale);
+
+        if (0 != SDL_UpdateTexture(m_texture, &target,
+            &m_converted[target.y * pitch + target.x], pitch * int(sizeof(Uint32))))
+        {
+            DoHaltSDLError("Failed to update screen texture.");
+        }
+    }
+
+    m_convertedRects.clear();
+    m_uploadPending = m_frameReady;
+
+    // Conversion thread can take the next frame
+    SDL_CondBroadcast(m_condition);
+    SDL_UnlockMutex(m_mutex);
+
+    m_lastPresent = now;
+
+    const int scaledWidth  = m_screen.width()  * m_scale;
+    const int scaledHeight = m_screen.height() * m_scale;
+
+    // Output area not covered by integer upscaled image is left black
+    int outputWidth;
+    int outputHeight;
+    SDL_GetRendererOutputSize(m_renderer, &outputWidth, &outputHeight);
+
+    SDL_Rect target;
+    target.w = scaledWidth;
+    target.h = scaledHeight;
+    target.x = (outputWidth  - scaledWidth ) / 2;
+    target.y = (outputHeight - scaledHeight) / 2;
+
+    SDL_RenderClear(m_renderer);
+    SDL_RenderCopy(m_renderer, m_texture, NULL, &target);
+    SDL_RenderPresent(m_renderer);
 }
 
 void Renderer::release()
 {
-    m_screen.release();
+    stopConvertThread();
+
+    if (NULL != m_texture)
+    {
+        SDL_DestroyTexture(m_texture);
+        m_texture = NULL;
+    }
 
     if (NULL != m_renderer)
     {
         SDL_DestroyRenderer(m_renderer);
+        m_renderer = NULL;
     }
 
+    m_screen.release();
+    m_background.release();
+    m_frame.clear();
+
     if (NULL != m_window)
     {
         SDL_DestroyWindow(m_window);
+        m_window = NULL;
     }
 }
 
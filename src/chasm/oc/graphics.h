@@ -22,6 +22,8 @@
 #ifndef OPENCHASM_OC_GRAPHICS_H_INCLUDED
 #define OPENCHASM_OC_GRAPHICS_H_INCLUDED
 
+#include "oc/memory.h"
+#include "oc/pixels.h"
 #include "oc/types.h"
 
 namespace OC
@@ -57,6 +59,15 @@ struct Rect : SDL_Rect
 class Bitmap
 {
 public:
+    // Lifetime of internal representation
+    // Level-scoped bitmaps are views into level arena
+    // and are released all at once by BitmapManager::releaseLevel()
+    enum ScopeType
+    {
+        SCOPE_GLOBAL,
+        SCOPE_LEVEL
+    };
+
     Bitmap();
 
     const bool isValid() const { return NULL != m_internal; }
@@ -64,21 +75,35 @@ public:
     const Uint16 width()  const; // XSize
     const Uint16 height() const; // YSize
     const Uint16 centeX() const; // CenterX
+    const int    pitch()  const; // bytes per row
+
+    // Image height of column-major bitmap, its rows may be longer because of padding
+    const Uint16 columnLength() const;
 
     const Uint8* pixels() const;                                      // p
+    Uint8* pixels();                                                  // p
     const Uint8 pixel(const Uint16 x, const Uint16 y) const;          // p
     void setPixel(const Uint16 x, const Uint16 y, const Uint8 value); // p
 
-    void create(const int width, const int height);
+    void create(const int width, const int height, const ScopeType scope = SCOPE_GLOBAL);
     void release();
 
+    // Creates transposed copy of source image, so each row holds one image column
+    // Row is padded to power of two by repeating image from the top, so texture coordinate
+    // stepping over columnLength() can be wrapped with a mask
+    void createColumnMajor(const Bitmap& source, const ScopeType scope = SCOPE_GLOBAL);
+
     // Loads image from .cel file by its name
     // Replaces LoadPicFromCel()
-    void load(const Path& path);
+    void load(const Path& path, const ScopeType scope = SCOPE_GLOBAL);
 
     // Loads image from given binary stream as raw data
     // Replaces LoadPic()
-    void load(BinaryInputStream& stream);
+    void load(BinaryInputStream& stream, const ScopeType scope = SCOPE_GLOBAL);
+
+    // Loads headerless image of given size from binary stream
+    void load(BinaryInputStream& stream, const Uint16 width, const Uint16 height,
+        const ScopeType scope = SCOPE_GLOBAL);
 
     // Draws itself to given destination bitmap at position (x, y)
     // Optional clip rectangle (in source coordinates)
@@ -92,6 +117,8 @@ public:
 
 private:
     SDL_Surface* m_internal;
+    Uint16       m_centerX;
+    Uint16       m_columnLength;
 
     enum FormatType
     {
@@ -99,7 +126,8 @@ private:
         FORMAT_PIC
     };
     
-    void load(BinaryInputStream& stream, const FormatType format);
+    void load(BinaryInputStream& stream, const FormatType format, const ScopeType scope);
+    void readPixels(BinaryInputStream& stream);
 };
 
 
@@ -112,9 +140,24 @@ public:
     BitmapManager();
     ~BitmapManager();
 
-    SDL_Surface* createSurface(const int width, const int height);
+    SDL_Surface* createSurface(const int width, const int height, const Bitmap::ScopeType scope);
     void releaseSurface(SDL_Surface* const surface);
 
+    // Releases all level-scoped surfaces and their pixel data at once
+    // Bitmap objects referring to them must be discarded beforehand
+    void releaseLevel();
+
+    // Diagnostic counters of live surfaces
+    struct Counters
+    {
+        size_t surfaces;
+        size_t bytes;
+
+        Counters();
+    };
+
+    const Counters& counters(const Bitmap::ScopeType scope) const { return m_counters[scope]; }
+
     // Replaces Contrast variable
     const Sint16 contrast() const { return m_contrast; }
     void setContrast(const Sint16 contrast);
@@ -130,9 +173,38 @@ public:
     // Replaces DoSetPalette(), SetPalette() functions
     void setPaletteParameters(const Sint16 contrast, const Sint16 color, const Sint16 brightness);
 
+    // Shared palette of all surfaces
+    const SDL_Palette* palette() const { return m_palette; }
+
 private:
-    typedef std::vector<SDL_Surface*> SurfaceList;
-    SurfaceList m_surfaces;
+    // Registry of surfaces, index of entry is stored in surface's userdata
+    // Released entries are linked into free list, live ones into per-scope lists
+    // So both registration and release are done in constant time
+    struct Entry
+    {
+        SDL_Surface*      surface;
+        Bitmap::ScopeType scope;
+
+        MemoryStats::Category category;
+
+        Uint32 prev;
+        Uint32 next;
+    };
+
+    static const Uint32 NO_ENTRY = 0xFFFFFFFF;
+
+    typedef std::vector<Entry> EntryList;
+    EntryList m_entries;
+
+    Uint32 m_freeEntry;
+
+    static const size_t SCOPE_COUNT = Bitmap::SCOPE_LEVEL + 1;
+
+    boost::array<Uint32,   SCOPE_COUNT> m_scopeEntries;
+    boost::array<Counters, SCOPE_COUNT> m_counters;
+
+    // Pixel data of level-scoped surfaces
+    Arena m_levelArena;
 
     typedef boost::array<SDL_Color, 256> Palette;
 
@@ -140,11 +212,18 @@ private:
     // Replaces Palette variable
     Palette m_original;
 
+    // Palette with limited color range [0..63] with parameters applied
+    Palette m_adjusted;
+
     // Palette with full color range [0..255] with parameters applied
-    // Ready to be used with SDL surfaces
+    // Ready to be used with SDL surfaces, screen tint and fade are applied by Renderer
     // Replaces Pal variable (with extended color range)
     Palette m_current;
 
+    // The only palette object, shared by all surfaces
+    // So palette update doesn't depend on number of surfaces
+    SDL_Palette* m_palette;
+
     Sint16 m_contrast;
     Sint16 m_color;
     Sint16 m_brightness;
@@ -153,7 +232,12 @@ private:
     Uint8 applyColor(const Uint8 color, const Sint16 coeff) const;
     Uint8 applyBrightness(const Uint8 color, const Sint16 coeff) const;
 
-    void applyPalette(SDL_Surface* const surface) const;
+    void updatePalette();
+
+    Uint32 registerSurface(SDL_Surface* const surface, const Bitmap::ScopeType scope);
+    void unregisterSurface(const Uint32 index);
+
+    void releaseScope(const Bitmap::ScopeType scope);
 };
 
 
@@ -165,29 +249,187 @@ class Renderer : public Singleton<Renderer>
     friend class SDLWrapper;
 
 public:
+    enum Backend
+    {
+        BACKEND_WINDOW,   // Window with accelerated renderer, presents paced by refresh rate
+        BACKEND_HEADLESS, // Memory only, no window and no vertical sync
+    };
+
     Renderer();
     ~Renderer();
 
     const Uint16 screenWidth() const;
     const Uint16 screenHeight() const;
 
+    Backend backend() const { return m_backend; }
+    // Takes effect on next setVideoMode() call
+    void setBackend(const Backend backend);
+
+    // Saves every N-th presented frame as BMP into user directory, zero disables
+    void setFrameDumpInterval(const Uint32 interval);
+
+    Uint32 frameCount() const { return m_frameCount; }
+
+    // Tints screen towards pure red, green or blue, levels are in [0..64] range
+    // Used for pain, pickup and similar screen flashes
+    void setTint(const Sint16 red, const Sint16 green, const Sint16 blue);
+
+    // Starts fading to given brightness level in [0..64] range, zero is black
+    // Fading is done during presents and doesn't block the caller
+    void fade(const Sint16 level, const Uint32 duration);
+    bool isFading() const;
+
+    // Both effects are applied in palette conversion of the final image,
+    // so they cost one 256 entries table rebuild per change
+
+    // Screen is upscaled by the largest integer factor fitting into window
+    // Both take effect on next setVideoMode() call
+    void setScaleFilter(const ScaleFilter filter);
+    void setWindowScale(const int scale);
+
     // Replaces part of SetVideoMode()
     void setVideoMode(const Uint16 width, const Uint16 height);
 
-    // Draws bitmap into screen buffer
+    // Screen buffer for software rendering, drawn areas must be invalidated
+    Bitmap& screen() { return m_screen; }
+
+    // Draws bitmap into screen buffer, marks drawn area as changed
     void draw(const Bitmap& image, const int x, const int y,
         const Rect& clip = Rect());
 
-    // Draws on screen, swap buffers
+    // Marks screen area as changed, only changed areas are presented
+    void invalidate(const Rect& area);
+    // Marks the whole screen as changed
+    void invalidate();
+
+    // True if next present() call will change the screen
+    bool hasChanges() const;
+
+    // Tiles bitmap into cached background layer
+    // Layer is rebuilt only when tile or video mode changes
+    void setBackground(const Bitmap& tile);
+    // Restores background in given screen area, whole screen by default
+    void drawBackground(const Rect& area = Rect());
+
+    // Shows converted frame if conversion is finished and display refresh period has passed,
+    // then passes changed areas of screen buffer to conversion thread, never waits for either
+    // Nothing is passed if screen and palette were not changed since the last call
     // Replaces ShowVideoBuffer() functions
     void present();
 
 private:
+    Backend       m_backend;
+
     SDL_Window*   m_window;
+
+    // Renderer and texture are used on main thread only, as SDL requires
     SDL_Renderer* m_renderer;
 
+    // Created once per video mode and upscaling factor, updated every frame
+    SDL_Texture*  m_texture;
+
+    // Replaces texture in headless mode
+    std::vector<Uint32> m_frame;
+
+    ScaleFilter m_scaleFilter;
+    int m_windowScale;
+
+    // Current upscaling factor, changed only while conversion thread is idle
+    int m_scale;
+
+    // Owned by conversion thread, upscaled area
+    std::vector<Uint8> m_scaled;
+
+    // Upscaled ARGB image written by conversion thread, uploaded to texture by main thread
+    std::vector<Uint32> m_converted;
+
     Bitmap        m_screen;
 
+    // Screen areas changed since the last present() call
+    typedef std::vector<Rect> RectList;
+    RectList m_dirty;
+
+    Bitmap        m_background;
+    const Bitmap* m_backgroundTile;
+
+    Uint32 m_frameCount;
+    Uint32 m_frameDumpInterval;
+
+    // Palette converted to texture pixel format, with tint and fade applied
+    boost::array<Uint32, 256> m_paletteLUT;
+    Uint32 m_paletteVersion;
+
+    typedef boost::array<Sint16, 3> Tint;
+
+    Tint   m_tint;
+    Sint16 m_fadeFrom;
+    Sint16 m_fadeTo;
+    Uint32 m_fadeStart;
+    Uint32 m_fadeDuration;
+
+    // Effects used to build current lookup table
+    Tint   m_lutTint;
+    Sint16 m_lutFade;
+
+    Sint16 fadeLevel() const;
+
+    // Screen contents with palette at the moment of present() call
+    struct Frame
+    {
+        std::vector<Uint8> pixels;
+        boost::array<Uint32, 256> lut;
+
+        // Areas changed since previous presented frame, used by conversion thread
+        RectList changed;
+        // Areas changed since this frame was filled last time, used by game thread
+        RectList outdated;
+    };
+
+    // Triple buffering: game thread fills write frame and swaps it with ready one,
+    // conversion thread swaps ready frame with its own one, upscales it and expands palette
+    // while game renders the next frame
+    // Ready frame not taken by conversion thread is replaced by the newer one
+    boost::array<Frame, 3> m_frames;
+
+    size_t m_writeFrame;
+    size_t m_readyFrame;
+    size_t m_convertFrame;
+
+    SDL_Thread* m_thread;
+    SDL_mutex*  m_mutex;
+    SDL_cond*   m_condition;
+
+    // Guarded by m_mutex
+    bool m_frameReady;
+    bool m_converting;
+    bool m_threadQuit;
+
+    // Areas of converted image not uploaded to texture yet, guarded by m_mutex
+    RectList m_convertedRects;
+
+    // Frame was passed to conversion thread and is not on screen yet
+    bool m_uploadPending;
+
+    // Display refresh period and time of the last present, in performance counter units
+    Uint64 m_presentInterval;
+    Uint64 m_lastPresent;
+
+    bool updatePaletteLUT();
+
+    void buildBackground();
+
+    void dumpFrame();
+
+    void startConvertThread();
+    void stopConvertThread();
+
+    static int SDLCALL convertThread(void* data);
+    void convertLoop();
+    void convertArea(const Frame& frame, const Rect& area);
+
+    void updateScale();
+    void showConverted();
+
     void release();
 };
 
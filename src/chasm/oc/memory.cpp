@@ -0,0 +1,242 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/memory.h"
+
+#include "oc/utils.h"
+
+namespace OC
+{
+
+namespace
+{
+
+// Slabs start at cache line boundary regardless of allocation alignment
+const size_t SLAB_ALIGNMENT = 64;
+
+size_t AlignUp(const size_t value, const size_t alignment)
+{
+    SDL_assert(0 == (alignment & (alignment - 1)));
+
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+} // unnamed namespace
+
+
+Arena::Arena(const size_t slabSize, const size_t alignment)
+: m_alignment(alignment)
+, m_used(0)
+, m_capacity(0)
+{
+    SDL_assert(slabSize > 0);
+    SDL_assert(alignment > 0 && alignment <= SLAB_ALIGNMENT);
+
+    addSlab(slabSize);
+}
+
+Arena::~Arena()
+{
+    freeSlabs();
+}
+
+
+void* Arena::allocate(const size_t size)
+{
+    const size_t alignedSize = AlignUp(std::max(size, size_t(1)), m_alignment);
+
+    Slab* slab = &m_slabs.back();
+
+    if (slab->offset + alignedSize > slab->size)
+    {
+        addSlab(std::max(alignedSize, m_slabs.front().size));
+        slab = &m_slabs.back();
+    }
+
+    void* const result = slab->begin + slab->offset;
+
+    slab->offset += alignedSize;
+    m_used       += alignedSize;
+
+    return result;
+}
+
+void Arena::reset()
+{
+    if (m_slabs.size() > 1)
+    {
+        const size_t totalSize = m_capacity;
+
+        freeSlabs();
+        addSlab(totalSize);
+    }
+    else
+    {
+        m_slabs.front().offset = 0;
+    }
+
+    m_used = 0;
+}
+
+
+void Arena::addSlab(const size_t size)
+{
+    Slab slab;
+    slab.memory = SDL_malloc(size + SLAB_ALIGNMENT - 1);
+
+    if (NULL == slab.memory)
+    {
+        DoHalt(Format("Failed to allocate %1% bytes of arena memory.") % size);
+    }
+
+    slab.begin  = reinterpret_cast<Uint8*>(AlignUp(reinterpret_cast<size_t>(slab.memory), SLAB_ALIGNMENT));
+    slab.size   = size;
+    slab.offset = 0;
+
+    m_slabs.push_back(slab);
+
+    m_capacity += size;
+}
+
+void Arena::freeSlabs()
+{
+    OC_FOREACH(const Slab& slab, m_slabs)
+    {
+        SDL_free(slab.memory);
+    }
+
+    m_slabs.clear();
+
+    m_capacity = 0;
+}
+
+
+
+// ===========================================================================
+
+
+namespace
+{
+
+struct MemoryCounter
+{
+    size_t current;
+    size_t peak;
+};
+
+// Zero-initialized before any dynamic initialization takes place
+MemoryCounter s_counters[MemoryStats::CATEGORY_COUNT];
+
+MemoryStats::Category s_bitmapCategory = MemoryStats::CATEGORY_TEXTURE;
+
+} // unnamed namespace
+
+
+void MemoryStats::allocate(const Category category, const size_t bytes)
+{
+    SDL_assert(category < CATEGORY_COUNT);
+
+    MemoryCounter& counter = s_counters[category];
+    counter.current += bytes;
+    counter.peak = std::max(counter.peak, counter.current);
+}
+
+void MemoryStats::release(const Category category, const size_t bytes)
+{
+    SDL_assert(category < CATEGORY_COUNT);
+
+    MemoryCounter& counter = s_counters[category];
+    SDL_assert(counter.current >= bytes);
+
+    counter.current -= bytes;
+}
+
+
+const size_t MemoryStats::current(const Category category)
+{
+    SDL_assert(category < CATEGORY_COUNT);
+
+    return s_counters[category].current;
+}
+
+const size_t MemoryStats::peak(const Category category)
+{
+    SDL_assert(category < CATEGORY_COUNT);
+
+    return s_counters[category].peak;
+}
+
+
+const char* MemoryStats::name(const Category category)
+{
+    static const char* const NAMES[CATEGORY_COUNT] =
+    {
+        "texture",
+        "model",
+        "animation",
+        "picture_pack",
+        "sound",
+        "level",
+        "temporary"
+    };
+
+    SDL_assert(category < CATEGORY_COUNT);
+
+    return NAMES[category];
+}
+
+
+const MemoryStats::Category MemoryStats::bitmapCategory()
+{
+    return s_bitmapCategory;
+}
+
+MemoryStats::Scope::Scope(const Category category)
+: m_previous(s_bitmapCategory)
+{
+    s_bitmapCategory = category;
+}
+
+MemoryStats::Scope::~Scope()
+{
+    s_bitmapCategory = m_previous;
+}
+
+
+String MemoryStats::toJSON()
+{
+    String result = "{\n";
+
+    for (int i = 0; i < CATEGORY_COUNT; ++i)
+    {
+        const Category category = Category(i);
+
+        result += (Format("    \"%1%\": { \"current\": %2%, \"peak\": %3% }%4%\n")
+            % name(category) % current(category) % peak(category)
+            % (CATEGORY_COUNT - 1 == i ? "" : ",")).str();
+    }
+
+    result += "}\n";
+
+    return result;
+}
+
+} // namespace OC
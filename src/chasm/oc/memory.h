@@ -0,0 +1,169 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_MEMORY_H_INCLUDED
+#define OPENCHASM_OC_MEMORY_H_INCLUDED
+
+#include "oc/types.h"
+
+namespace OC
+{
+
+// Bump allocator over large aligned slabs
+// Individual allocations cannot be freed, the whole arena is reset at once
+// When current slab is exhausted additional slab is chained,
+// on reset all slabs are coalesced into single one of total capacity
+// so the next cycle of allocations fits into contiguous memory
+
+class Arena : boost::noncopyable
+{
+public:
+    explicit Arena(const size_t slabSize, const size_t alignment = 16);
+    ~Arena();
+
+    void* allocate(const size_t size);
+
+    // Forgets all allocations, memory is kept for reuse
+    void reset();
+
+    const size_t used()     const { return m_used;     }
+    const size_t capacity() const { return m_capacity; }
+
+private:
+    struct Slab
+    {
+        void*  memory;  // as returned by SDL_malloc()
+        Uint8* begin;   // aligned start of slab
+        size_t size;
+        size_t offset;
+    };
+
+    typedef std::vector<Slab> SlabList;
+    SlabList m_slabs;
+
+    const size_t m_alignment;
+
+    size_t m_used;
+    size_t m_capacity;
+
+    void addSlab(const size_t size);
+    void freeSlabs();
+};
+
+
+
+// ===========================================================================
+
+
+// Accounting of memory occupied by assets of different kinds
+// Counters have static storage so they are valid even during
+// destruction of global objects after exit from main()
+
+class MemoryStats
+{
+public:
+    enum Category
+    {
+        CATEGORY_TEXTURE,
+        CATEGORY_MODEL,
+        CATEGORY_ANIMATION,
+        CATEGORY_PICTURE_PACK,
+        CATEGORY_SOUND,
+        CATEGORY_LEVEL,
+        CATEGORY_TEMPORARY,
+
+        CATEGORY_COUNT
+    };
+
+    static void allocate(const Category category, const size_t bytes);
+    static void release(const Category category, const size_t bytes);
+
+    static const size_t current(const Category category);
+    static const size_t peak(const Category category);
+
+    static const char* name(const Category category);
+
+    // Category of bitmaps created while scope object exists
+    // It's independent from bitmap lifetime scope
+    // Short-lived intermediate bitmaps go to CATEGORY_TEMPORARY
+    // so they don't inflate peaks of asset categories
+    static const Category bitmapCategory();
+
+    class Scope : boost::noncopyable
+    {
+    public:
+        explicit Scope(const Category category);
+        ~Scope();
+
+    private:
+        const Category m_previous;
+    };
+
+    // Returns all counters as JSON object
+    static String toJSON();
+};
+
+
+// Standard allocator that accounts allocated memory in given category
+
+template <typename T, MemoryStats::Category C>
+class TrackedAllocator : public std::allocator<T>
+{
+public:
+    typedef typename std::allocator<T>::pointer   pointer;
+    typedef typename std::allocator<T>::size_type size_type;
+
+    template <typename U>
+    struct rebind
+    {
+        typedef TrackedAllocator<U, C> other;
+    };
+
+    TrackedAllocator()
+    {
+    }
+
+    TrackedAllocator(const TrackedAllocator&)
+    : std::allocator<T>()
+    {
+    }
+
+    template <typename U>
+    TrackedAllocator(const TrackedAllocator<U, C>&)
+    {
+    }
+
+    pointer allocate(const size_type count, const void* const hint = NULL)
+    {
+        MemoryStats::allocate(C, count * sizeof(T));
+        return std::allocator<T>::allocate(count, hint);
+    }
+
+    void deallocate(const pointer memory, const size_type count)
+    {
+        MemoryStats::release(C, count * sizeof(T));
+        std::allocator<T>::deallocate(memory, count);
+    }
+};
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_MEMORY_H_INCLUDED
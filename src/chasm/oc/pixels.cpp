@@ -0,0 +1,840 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/pixels.h"
+
+#include "oc/utils.h"
+
+namespace OC
+{
+
+namespace
+{
+
+typedef void (*ExpandRowFunction)(Uint32* dest, const Uint8* source, size_t count, const Uint32* lut);
+
+void ExpandRowScalar(Uint32* dest, const Uint8* source, size_t count, const Uint32* lut)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        dest[i] = lut[source[i]];
+    }
+}
+
+
+#ifdef OC_SIMD_X86
+
+// Destination is uploaded to texture right after expansion, so regular stores
+// keep it in cache, lookups are done with gather from table of 32-bit pixels
+
+OC_SIMD_TARGET("avx2")
+void ExpandRowAVX2(Uint32* dest, const Uint8* source, size_t count, const Uint32* lut)
+{
+    const int* const table = reinterpret_cast<const int*>(lut);
+
+    for (/* EMPTY */; count >= 16; count -= 16)
+    {
+        const __m128i indices = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+
+        const __m256i p0 = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(indices), 4);
+        const __m256i p1 = _mm256_i32gather_epi32(table, _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8)), 4);
+
+        __m256i* const vdest = reinterpret_cast<__m256i*>(dest);
+        _mm256_storeu_si256(vdest + 0, p0);
+        _mm256_storeu_si256(vdest + 1, p1);
+
+        dest   += 16;
+        source += 16;
+    }
+
+    ExpandRowScalar(dest, source, count, lut);
+}
+
+#endif // OC_SIMD_X86
+
+
+#ifdef OC_SIMD_NEON
+
+// Lookup table is split into four byte planes, each is looked up
+// with four 64-byte table lookups, then planes are interleaved on store
+// Planes are rebuilt for every image, so palette changes are never missed,
+// callers may expand images with different tables concurrently
+
+struct NEONPlanes
+{
+    uint8x16x4_t planes[4][4]; // [byte][quarter of table]
+};
+
+void PrepareNEONPlanes(const Uint32* const lut, NEONPlanes& neonPlanes)
+{
+    Uint8 bytes[4][256];
+
+    for (int i = 0; i < 256; ++i)
+    {
+        bytes[0][i] = Uint8(lut[i]);
+        bytes[1][i] = Uint8(lut[i] >>  8);
+        bytes[2][i] = Uint8(lut[i] >> 16);
+        bytes[3][i] = Uint8(lut[i] >> 24);
+    }
+
+    for (int b = 0; b < 4; ++b)
+    {
+        for (int q = 0; q < 4; ++q)
+        {
+            neonPlanes.planes[b][q] = vld1q_u8_x4(&bytes[b][q * 64]);
+        }
+    }
+}
+
+inline uint8x16_t LookupNEON(const uint8x16x4_t (&quarters)[4], const uint8x16_t indices)
+{
+    const uint8x16_t offset = vdupq_n_u8(64);
+
+    uint8x16_t i = indices;
+    uint8x16_t result = vqtbl4q_u8(quarters[0], i);
+
+    i = vsubq_u8(i, offset);
+    result = vqtbx4q_u8(result, quarters[1], i);
+
+    i = vsubq_u8(i, offset);
+    result = vqtbx4q_u8(result, quarters[2], i);
+
+    i = vsubq_u8(i, offset);
+    result = vqtbx4q_u8(result, quarters[3], i);
+
+    return result;
+}
+
+void ExpandRowNEON(Uint32* dest, const Uint8* source, size_t count, const Uint32* lut,
+    const NEONPlanes& neonPlanes)
+{
+    for (/* EMPTY */; count >= 16; count -= 16)
+    {
+        const uint8x16_t indices = vld1q_u8(source);
+
+        uint8x16x4_t pixels;
+        pixels.val[0] = LookupNEON(neonPlanes.planes[0], indices);
+        pixels.val[1] = LookupNEON(neonPlanes.planes[1], indices);
+        pixels.val[2] = LookupNEON(neonPlanes.planes[2], indices);
+        pixels.val[3] = LookupNEON(neonPlanes.planes[3], indices);
+
+        vst4q_u8(reinterpret_cast<Uint8*>(dest), pixels);
+
+        dest   += 16;
+        source += 16;
+    }
+
+    ExpandRowScalar(dest, source, count, lut);
+}
+
+#endif // OC_SIMD_NEON
+
+
+ExpandRowFunction SelectExpandRow(const SIMDType type)
+{
+    SDL_assert(IsSIMDSupported(type));
+
+    switch (type)
+    {
+#ifdef OC_SIMD_X86
+        case SIMD_AVX2:
+            return ExpandRowAVX2;
+#endif // OC_SIMD_X86
+
+        default:
+            return ExpandRowScalar;
+    }
+}
+
+bool HasExpandVariant(const SIMDType type)
+{
+    return IsSIMDSupported(type)
+        && (SIMD_NONE == type || SIMD_NEON == type || ExpandRowScalar != SelectExpandRow(type));
+}
+
+SIMDType SelectFastestExpand();
+
+} // unnamed namespace
+
+
+void ExpandPixels(Uint32* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height, const Uint32* const lut)
+{
+    // Widest instruction set is not always the fastest one,
+    // e.g. AVX2 gather is slow on some CPUs, so variants are timed once
+    static const SIMDType bestType = SelectFastestExpand();
+
+    ExpandPixels(bestType, dest, destPitch, source, sourcePitch, width, height, lut);
+}
+
+void ExpandPixels(const SIMDType type, Uint32* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height, const Uint32* const lut)
+{
+    SDL_assert(NULL != dest);
+    SDL_assert(NULL != source);
+    SDL_assert(NULL != lut);
+
+    Uint8* destRow = reinterpret_cast<Uint8*>(dest);
+    const Uint8* sourceRow = source;
+
+#ifdef OC_SIMD_NEON
+    // NEON variant needs byte planes of lookup table
+    if (SIMD_NEON == type)
+    {
+        NEONPlanes neonPlanes;
+        PrepareNEONPlanes(lut, neonPlanes);
+
+        for (int y = 0; y < height; ++y)
+        {
+            ExpandRowNEON(reinterpret_cast<Uint32*>(destRow), sourceRow, size_t(width), lut, neonPlanes);
+
+            destRow   += destPitch;
+            sourceRow += sourcePitch;
+        }
+
+        return;
+    }
+#endif // OC_SIMD_NEON
+
+    const ExpandRowFunction expandRow = SelectExpandRow(type);
+
+    for (int y = 0; y < height; ++y)
+    {
+        expandRow(reinterpret_cast<Uint32*>(destRow), sourceRow, size_t(width), lut);
+
+        destRow   += destPitch;
+        sourceRow += sourcePitch;
+    }
+}
+
+
+// ===========================================================================
+
+
+namespace
+{
+
+// Nearest neighbour: repeats each pixel of row factor times
+
+void ScaleRowNearestScalar(Uint8* dest, const Uint8* source, int width, const int factor)
+{
+    for (int x = 0; x < width; ++x)
+    {
+        for (int i = 0; i < factor; ++i)
+        {
+            *dest++ = source[x];
+        }
+    }
+}
+
+// Scale2x/EPX: produces two rows from source row and its vertical neighbours
+// For pixel E with neighbours B (above), D (left), F (right) and H (below):
+// E0 = D, E1 = F, E2 = D, E3 = F when corresponding neighbours are equal
+// and opposite ones differ, E otherwise
+
+void ScaleRowEPXScalar(Uint8* top, Uint8* bottom,
+    const Uint8* above, const Uint8* row, const Uint8* below,
+    const int begin, const int end, const int width)
+{
+    for (int x = begin; x < end; ++x)
+    {
+        const Uint8 B = above[x];
+        const Uint8 D = row[0 == x ? x : x - 1];
+        const Uint8 E = row[x];
+        const Uint8 F = row[width - 1 == x ? x : x + 1];
+        const Uint8 H = below[x];
+
+        if (B != H && D != F)
+        {
+            top   [x * 2    ] = D == B ? D : E;
+            top   [x * 2 + 1] = B == F ? F : E;
+            bottom[x * 2    ] = D == H ? D : E;
+            bottom[x * 2 + 1] = H == F ? F : E;
+        }
+        else
+        {
+            top   [x * 2    ] = E;
+            top   [x * 2 + 1] = E;
+            bottom[x * 2    ] = E;
+            bottom[x * 2 + 1] = E;
+        }
+    }
+}
+
+
+#ifdef OC_SIMD_X86
+
+OC_SIMD_TARGET("sse2")
+void ScaleRowNearestSSE2(Uint8* dest, const Uint8* source, int width, const int factor)
+{
+    // SSE2 has no byte shuffle required for 3x
+    if (3 == factor)
+    {
+        ScaleRowNearestScalar(dest, source, width, factor);
+        return;
+    }
+
+    for (/* EMPTY */; width >= 16; width -= 16)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source));
+        const __m128i lo = _mm_unpacklo_epi8(pixels, pixels);
+        const __m128i hi = _mm_unpackhi_epi8(pixels, pixels);
+
+        __m128i* const vdest = reinterpret_cast<__m128i*>(dest);
+
+        if (2 == factor)
+        {
+            _mm_storeu_si128(vdest + 0, lo);
+            _mm_storeu_si128(vdest + 1, hi);
+        }
+        else
+        {
+            _mm_storeu_si128(vdest + 0, _mm_unpacklo_epi8(lo, lo));
+            _mm_storeu_si128(vdest + 1, _mm_unpackhi_epi8(lo, lo));
+            _mm_storeu_si128(vdest + 2, _mm_unpacklo_epi8(hi, hi));
+            _mm_storeu_si128(vdest + 3, _mm_unpackhi_epi8(hi, hi));
+        }
+
+        dest   += 16 * factor;
+        source += 16;
+    }
+
+    ScaleRowNearestScalar(dest, source, width, factor);
+}
+
+OC_SIMD_TARGET("sse2")
+inline __m128i SelectSSE2(const __m128i mask, const __m128i a, const __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+OC_SIMD_TARGET("sse2")
+void ScaleRowEPXSSE2(Uint8* top, Uint8* bottom,
+    const Uint8* above, const Uint8* row, const Uint8* below, const int width)
+{
+    // First and last pixels have clamped neighbours, they are handled by scalar code
+    ScaleRowEPXScalar(top, bottom, above, row, below, 0, std::min(width, 1), width);
+
+    int x = 1;
+
+    for (/* EMPTY */; x + 17 <= width; x += 16)
+    {
+        const __m128i B = _mm_loadu_si128(reinterpret_cast<const __m128i*>(above + x));
+        const __m128i D = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x - 1));
+        const __m128i E = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x));
+        const __m128i F = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row + x + 1));
+        const __m128i H = _mm_loadu_si128(reinterpret_cast<const __m128i*>(below + x));
+
+        const __m128i differ = _mm_andnot_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(B, H), _mm_cmpeq_epi8(D, F)), _mm_set1_epi8(-1));
+
+        const __m128i E0 = SelectSSE2(_mm_and_si128(differ, _mm_cmpeq_epi8(D, B)), D, E);
+        const __m128i E1 = SelectSSE2(_mm_and_si128(differ, _mm_cmpeq_epi8(B, F)), F, E);
+        const __m128i E2 = SelectSSE2(_mm_and_si128(differ, _mm_cmpeq_epi8(D, H)), D, E);
+        const __m128i E3 = SelectSSE2(_mm_and_si128(differ, _mm_cmpeq_epi8(H, F)), F, E);
+
+        __m128i* const vtop    = reinterpret_cast<__m128i*>(top    + x * 2);
+        __m128i* const vbottom = reinterpret_cast<__m128i*>(bottom + x * 2);
+
+        _mm_storeu_si128(vtop    + 0, _mm_unpacklo_epi8(E0, E1));
+        _mm_storeu_si128(vtop    + 1, _mm_unpackhi_epi8(E0, E1));
+        _mm_storeu_si128(vbottom + 0, _mm_unpacklo_epi8(E2, E3));
+        _mm_storeu_si128(vbottom + 1, _mm_unpackhi_epi8(E2, E3));
+    }
+
+    ScaleRowEPXScalar(top, bottom, above, row, below, x, width, width);
+}
+
+#endif // OC_SIMD_X86
+
+
+#ifdef OC_SIMD_NEON
+
+void ScaleRowNearestNEON(Uint8* dest, const Uint8* source, int width, const int factor)
+{
+    for (/* EMPTY */; width >= 16; width -= 16)
+    {
+        const uint8x16_t pixels = vld1q_u8(source);
+
+        if (2 == factor)
+        {
+            const uint8x16x2_t result = { { pixels, pixels } };
+            vst2q_u8(dest, result);
+        }
+        else if (3 == factor)
+        {
+            const uint8x16x3_t result = { { pixels, pixels, pixels } };
+            vst3q_u8(dest, result);
+        }
+        else
+        {
+            const uint8x16x4_t result = { { pixels, pixels, pixels, pixels } };
+            vst4q_u8(dest, result);
+        }
+
+        dest   += 16 * factor;
+        source += 16;
+    }
+
+    ScaleRowNearestScalar(dest, source, width, factor);
+}
+
+void ScaleRowEPXNEON(Uint8* top, Uint8* bottom,
+    const Uint8* above, const Uint8* row, const Uint8* below, const int width)
+{
+    ScaleRowEPXScalar(top, bottom, above, row, below, 0, std::min(width, 1), width);
+
+    int x = 1;
+
+    for (/* EMPTY */; x + 17 <= width; x += 16)
+    {
+        const uint8x16_t B = vld1q_u8(above + x);
+        const uint8x16_t D = vld1q_u8(row + x - 1);
+        const uint8x16_t E = vld1q_u8(row + x);
+        const uint8x16_t F = vld1q_u8(row + x + 1);
+        const uint8x16_t H = vld1q_u8(below + x);
+
+        const uint8x16_t differ = vmvnq_u8(vorrq_u8(vceqq_u8(B, H), vceqq_u8(D, F)));
+
+        const uint8x16x2_t upper = { {
+            vbslq_u8(vandq_u8(differ, vceqq_u8(D, B)), D, E),
+            vbslq_u8(vandq_u8(differ, vceqq_u8(B, F)), F, E) } };
+        const uint8x16x2_t lower = { {
+            vbslq_u8(vandq_u8(differ, vceqq_u8(D, H)), D, E),
+            vbslq_u8(vandq_u8(differ, vceqq_u8(H, F)), F, E) } };
+
+        vst2q_u8(top    + x * 2, upper);
+        vst2q_u8(bottom + x * 2, lower);
+    }
+
+    ScaleRowEPXScalar(top, bottom, above, row, below, x, width, width);
+}
+
+#endif // OC_SIMD_NEON
+
+
+typedef void (*ScaleRowNearestFunction)(Uint8* dest, const Uint8* source, int width, const int factor);
+typedef void (*ScaleRowEPXFunction)(Uint8* top, Uint8* bottom,
+    const Uint8* above, const Uint8* row, const Uint8* below, const int width);
+
+void ScaleRowEPXGeneric(Uint8* top, Uint8* bottom,
+    const Uint8* above, const Uint8* row, const Uint8* below, const int width)
+{
+    ScaleRowEPXScalar(top, bottom, above, row, below, 0, width, width);
+}
+
+// Gathers and AVX2 wide registers give nothing for byte shuffles,
+// so AVX2 capable CPUs use SSE2 variants
+void SelectScaleRow(const SIMDType type, ScaleRowNearestFunction& nearest, ScaleRowEPXFunction& epx)
+{
+    SDL_assert(IsSIMDSupported(type));
+
+    switch (type)
+    {
+#ifdef OC_SIMD_X86
+        case SIMD_SSE2:
+        case SIMD_AVX2:
+            nearest = ScaleRowNearestSSE2;
+            epx     = ScaleRowEPXSSE2;
+            break;
+#endif // OC_SIMD_X86
+
+#ifdef OC_SIMD_NEON
+        case SIMD_NEON:
+            nearest = ScaleRowNearestNEON;
+            epx     = ScaleRowEPXNEON;
+            break;
+#endif // OC_SIMD_NEON
+
+        default:
+            nearest = ScaleRowNearestScalar;
+            epx     = ScaleRowEPXGeneric;
+            break;
+    }
+}
+
+void ScaleNearest(const ScaleRowNearestFunction scaleRow, const int factor,
+    Uint8* dest, const int destPitch, const Uint8* source, const int sourcePitch,
+    const int width, const int height)
+{
+    const size_t destWidth = size_t(width) * factor;
+
+    for (int y = 0; y < height; ++y)
+    {
+        scaleRow(dest, source, width, factor);
+
+        // Remaining rows are copies of the first one
+        for (int i = 1; i < factor; ++i)
+        {
+            SDL_memcpy(dest + i * destPitch, dest, destWidth);
+        }
+
+        dest   += destPitch * factor;
+        source += sourcePitch;
+    }
+}
+
+void ScaleEPX(const ScaleRowEPXFunction scaleRow,
+    Uint8* dest, const int destPitch, const Uint8* source, const int sourcePitch,
+    const int width, const int height)
+{
+    for (int y = 0; y < height; ++y)
+    {
+        const Uint8* const row   = source + y * sourcePitch;
+        const Uint8* const above = 0 == y          ? row : row - sourcePitch;
+        const Uint8* const below = height - 1 == y ? row : row + sourcePitch;
+
+        scaleRow(dest, dest + destPitch, above, row, below, width);
+
+        dest += destPitch * 2;
+    }
+}
+
+// Applies Scale2x twice, intermediate rows are kept for three source rows only
+void ScaleEPX4x(const ScaleRowEPXFunction scaleRow,
+    Uint8* dest, const int destPitch, const Uint8* source, const int sourcePitch,
+    const int width, const int height)
+{
+    const int width2 = width * 2;
+
+    std::vector<Uint8> rows(size_t(width2) * 6);
+
+    // Pairs of intermediate rows for previous, current and next source rows
+    Uint8* previous = &rows[0];
+    Uint8* current  = &rows[width2 * 2];
+    Uint8* next     = &rows[width2 * 4];
+
+    const Uint8* const lastRow = source + (height - 1) * sourcePitch;
+
+    for (int y = 0; y < height; ++y)
+    {
+        const Uint8* const row = source + y * sourcePitch;
+
+        if (0 == y)
+        {
+            scaleRow(current, current + width2, row, row, std::min(row + sourcePitch, lastRow), width);
+        }
+
+        if (y + 1 < height)
+        {
+            const Uint8* const nextRow = row + sourcePitch;
+            scaleRow(next, next + width2, row, nextRow, std::min(nextRow + sourcePitch, lastRow), width);
+        }
+
+        const Uint8* const upper = current;
+        const Uint8* const lower = current + width2;
+
+        scaleRow(dest, dest + destPitch,
+            0 == y ? upper : previous + width2, upper, lower, width2);
+        dest += destPitch * 2;
+
+        scaleRow(dest, dest + destPitch,
+            upper, lower, height - 1 == y ? lower : next, width2);
+        dest += destPitch * 2;
+
+        Uint8* const recycled = previous;
+        previous = current;
+        current  = next;
+        next     = recycled;
+    }
+}
+
+SIMDType SelectScaleSIMD()
+{
+    if (IsSIMDSupported(SIMD_NEON))
+    {
+        return SIMD_NEON;
+    }
+
+    return IsSIMDSupported(SIMD_SSE2) ? SIMD_SSE2 : SIMD_NONE;
+}
+
+} // unnamed namespace
+
+
+void ScalePixels(const ScaleFilter filter, const int factor,
+    Uint8* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height)
+{
+    static const SIMDType type = SelectScaleSIMD();
+
+    ScalePixels(type, filter, factor, dest, destPitch, source, sourcePitch, width, height);
+}
+
+void ScalePixels(const SIMDType type, const ScaleFilter filter, const int factor,
+    Uint8* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height)
+{
+    SDL_assert(NULL != dest);
+    SDL_assert(NULL != source);
+    SDL_assert(factor >= 1 && factor <= MAX_SCALE_FACTOR);
+
+    ScaleRowNearestFunction nearest;
+    ScaleRowEPXFunction epx;
+
+    SelectScaleRow(type, nearest, epx);
+
+    if (1 == factor)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            SDL_memcpy(dest + y * destPitch, source + y * sourcePitch, width);
+        }
+    }
+    else if (SCALE_EPX == filter && 2 == factor)
+    {
+        ScaleEPX(epx, dest, destPitch, source, sourcePitch, width, height);
+    }
+    else if (SCALE_EPX == filter && 4 == factor)
+    {
+        ScaleEPX4x(epx, dest, destPitch, source, sourcePitch, width, height);
+    }
+    else
+    {
+        ScaleNearest(nearest, factor, dest, destPitch, source, sourcePitch, width, height);
+    }
+}
+
+
+// ===========================================================================
+
+
+namespace
+{
+
+SIMDType SelectFastestExpand()
+{
+    static const int WIDTH  = 640;
+    static const int HEIGHT = 480;
+    static const int RUNS   = 4;
+
+    boost::array<Uint32, 256> lut;
+    lut.fill(0);
+
+    std::vector<Uint8 > source(WIDTH * HEIGHT);
+    std::vector<Uint32> dest  (WIDTH * HEIGHT);
+
+    SIMDType result = SIMD_NONE;
+    Uint64 resultTime = Uint64(-1);
+
+    for (int t = 0; t < SIMD_COUNT; ++t)
+    {
+        const SIMDType type = SIMDType(t);
+
+        if (!HasExpandVariant(type))
+        {
+            continue;
+        }
+
+        Uint64 bestTime = Uint64(-1);
+
+        for (int i = 0; i < RUNS; ++i)
+        {
+            const Uint64 start = SDL_GetPerformanceCounter();
+
+            ExpandPixels(type, &dest[0], WIDTH * 4, &source[0], WIDTH, WIDTH, HEIGHT, &lut[0]);
+
+            bestTime = std::min(bestTime, SDL_GetPerformanceCounter() - start);
+        }
+
+        if (bestTime < resultTime)
+        {
+            result = type;
+            resultTime = bestTime;
+        }
+    }
+
+    SDL_Log("Pixel expansion uses %s variant", SIMDName(result));
+
+    return result;
+}
+
+} // unnamed namespace
+
+
+void BenchmarkPixelKernels()
+{
+    static const int RESOLUTIONS[][2] =
+    {
+        {  640,  480 },
+        {  800,  600 },
+        { 1024,  768 },
+        { 1280,  720 },
+        { 1920, 1080 },
+        { 2560, 1440 },
+        { 3840, 2160 },
+    };
+
+    // Minimal measurement time for each variant, in seconds
+    static const Double MEASURE_TIME = 0.25;
+
+    boost::array<Uint32, 256> lut;
+
+    for (size_t i = 0; i < lut.size(); ++i)
+    {
+        lut[i] = 0xFF000000 | Uint32(i * 0x010305);
+    }
+
+    const Double frequency = Double(SDL_GetPerformanceFrequency());
+
+    SDL_Log("Pixel expansion benchmark, widest instruction set is %s", SIMDName(BestSIMD()));
+
+    for (size_t r = 0; r < SDL_arraysize(RESOLUTIONS); ++r)
+    {
+        const int width  = RESOLUTIONS[r][0];
+        const int height = RESOLUTIONS[r][1];
+        const size_t pixelCount = size_t(width) * height;
+
+        std::vector<Uint8> source(pixelCount);
+
+        for (size_t i = 0; i < pixelCount; ++i)
+        {
+            source[i] = Uint8(rand());
+        }
+
+        std::vector<Uint32> reference(pixelCount);
+        std::vector<Uint32> result(pixelCount);
+
+        ExpandPixels(SIMD_NONE, &reference[0], width * 4, &source[0], width, width, height, &lut[0]);
+
+        for (int t = 0; t < SIMD_COUNT; ++t)
+        {
+            const SIMDType type = SIMDType(t);
+
+            if (!HasExpandVariant(type))
+            {
+                continue;
+            }
+
+            std::fill(result.begin(), result.end(), 0);
+
+            const Uint64 start = SDL_GetPerformanceCounter();
+            Uint64 now = start;
+            int frames = 0;
+
+            do
+            {
+                ExpandPixels(type, &result[0], width * 4, &source[0], width, width, height, &lut[0]);
+
+                ++frames;
+                now = SDL_GetPerformanceCounter();
+            }
+            while ((now - start) / frequency < MEASURE_TIME);
+
+            const Double seconds = (now - start) / frequency / frames;
+            const Double bandwidth = pixelCount * (sizeof(Uint8) + sizeof(Uint32)) / seconds / (1024.0 * 1024.0 * 1024.0);
+
+            const bool exact = 0 == SDL_memcmp(&reference[0], &result[0], pixelCount * sizeof(Uint32));
+
+            SDL_Log("  %4ix%-4i %-6s %8.3f ms %6.2f GB/s%s", width, height, SIMDName(type),
+                seconds * 1000.0, bandwidth, exact ? "" : "  MISMATCH");
+
+            if (!exact)
+            {
+                DoHalt(Format("Pixel expansion variant %1% differs from scalar one.") % SIMDName(type));
+            }
+        }
+    }
+
+    static const int SCALE_SOURCES[][2] =
+    {
+        { 640, 480 },
+        { 960, 540 },
+    };
+
+    static const char* const FILTER_NAMES[] = { "nearest", "EPX" };
+
+    SDL_Log("Pixel upscaling benchmark");
+
+    for (size_t r = 0; r < SDL_arraysize(SCALE_SOURCES); ++r)
+    {
+        const int width  = SCALE_SOURCES[r][0];
+        const int height = SCALE_SOURCES[r][1];
+
+        // Few colors make equal neighbours common, so all EPX cases are exercised
+        std::vector<Uint8> source(size_t(width) * height);
+
+        for (size_t i = 0; i < source.size(); ++i)
+        {
+            source[i] = Uint8(rand() & 3);
+        }
+
+        for (int filter = SCALE_NEAREST; filter <= SCALE_EPX; ++filter)
+        {
+            for (int factor = 2; factor <= MAX_SCALE_FACTOR; ++factor)
+            {
+                const int destWidth  = width  * factor;
+                const int destHeight = height * factor;
+                const size_t destSize = size_t(destWidth) * destHeight;
+
+                std::vector<Uint8> reference(destSize);
+                std::vector<Uint8> result(destSize);
+
+                ScalePixels(SIMD_NONE, ScaleFilter(filter), factor,
+                    &reference[0], destWidth, &source[0], width, width, height);
+
+                for (int t = 0; t < SIMD_COUNT; ++t)
+                {
+                    const SIMDType type = SIMDType(t);
+
+                    if (!IsSIMDSupported(type))
+                    {
+                        continue;
+                    }
+
+                    std::fill(result.begin(), result.end(), 0);
+
+                    const Uint64 start = SDL_GetPerformanceCounter();
+                    Uint64 now = start;
+                    int frames = 0;
+
+                    do
+                    {
+                        ScalePixels(type, ScaleFilter(filter), factor,
+                            &result[0], destWidth, &source[0], width, width, height);
+
+                        ++frames;
+                        now = SDL_GetPerformanceCounter();
+                    }
+                    while ((now - start) / frequency < MEASURE_TIME);
+
+                    const Double seconds = (now - start) / frequency / frames;
+                    const bool exact = reference == result;
+
+                    SDL_Log("  %4ix%-4i %ix %-7s to %4ix%-4i %-6s %8.3f ms%s", width, height,
+                        factor, FILTER_NAMES[filter], destWidth, destHeight, SIMDName(type),
+                        seconds * 1000.0, exact ? "" : "  MISMATCH");
+
+                    if (!exact)
+                    {
+                        DoHalt(Format("Pixel upscaling variant %1% differs from scalar one.") % SIMDName(type));
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace OC
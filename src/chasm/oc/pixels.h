@@ -0,0 +1,69 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_PIXELS_H_INCLUDED
+#define OPENCHASM_OC_PIXELS_H_INCLUDED
+
+#include "oc/simd.h"
+
+namespace OC
+{
+
+// Converts 8-bit indexed image to 32-bit one using 256 entries lookup table
+// Pitches are in bytes, variant for the best instruction set is used
+void ExpandPixels(Uint32* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height, const Uint32* const lut);
+
+// Same as above with explicitly given instruction set, must be supported by CPU
+void ExpandPixels(const SIMDType type, Uint32* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height, const Uint32* const lut);
+
+enum ScaleFilter
+{
+    SCALE_NEAREST, // Each pixel becomes square block
+    SCALE_EPX,     // Scale2x/EPX edge smoothing, nearest is used for 3x
+};
+
+// Maximal factor supported by ScalePixels()
+const int MAX_SCALE_FACTOR = 4;
+
+// Upscales 8-bit image by integer factor from 1 to MAX_SCALE_FACTOR
+// Destination must have room for (width * factor) x (height * factor) pixels
+void ScalePixels(const ScaleFilter filter, const int factor,
+    Uint8* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height);
+
+// Same as above with explicitly given instruction set, must be supported by CPU
+void ScalePixels(const SIMDType type, const ScaleFilter filter, const int factor,
+    Uint8* const dest, const int destPitch,
+    const Uint8* const source, const int sourcePitch,
+    const int width, const int height);
+
+// Measures and logs speed of all supported variants of pixel kernels
+// Results of SIMD variants are checked against scalar ones
+void BenchmarkPixelKernels();
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_PIXELS_H_INCLUDED
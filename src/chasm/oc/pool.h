@@ -0,0 +1,248 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_POOL_H_INCLUDED
+#define OPENCHASM_OC_POOL_H_INCLUDED
+
+#include "oc/types.h"
+
+namespace OC
+{
+
+// Reference to object stored in Pool
+// Becomes invalid when object is removed, even if its slot is reused later
+
+struct PoolHandle
+{
+    Uint32 slot;
+    Uint32 generation;
+
+    PoolHandle()
+    : slot(0xFFFFFFFF)
+    , generation(0)
+    {
+    }
+
+    bool operator==(const PoolHandle& other) const
+    {
+        return slot == other.slot && generation == other.generation;
+    }
+
+    bool operator!=(const PoolHandle& other) const
+    {
+        return !(*this == other);
+    }
+};
+
+
+// ===========================================================================
+
+
+// Growable storage of objects with dense layout
+// Iteration goes over live objects only, removal swaps the last object into freed place
+// So dense indices are not stable, use handles for cross-references
+
+template <typename T>
+class Pool : boost::noncopyable
+{
+public:
+    typedef typename std::vector<T>::iterator       iterator;
+    typedef typename std::vector<T>::const_iterator const_iterator;
+
+    // Adding of new objects fails when pool contains maxSize objects already
+    explicit Pool(const size_t maxSize)
+    : m_maxSize(maxSize)
+    , m_freeSlot(NO_INDEX)
+    {
+    }
+
+    const size_t size()    const { return m_items.size();  }
+    const bool   empty()   const { return m_items.empty(); }
+    const size_t maxSize() const { return m_maxSize;       }
+
+    void setMaxSize(const size_t maxSize)
+    {
+        SDL_assert(maxSize >= size());
+        m_maxSize = maxSize;
+    }
+
+    iterator begin() { return m_items.begin(); }
+    iterator end()   { return m_items.end();   }
+
+    const_iterator begin() const { return m_items.begin(); }
+    const_iterator end()   const { return m_items.end();   }
+
+    // Access by dense index, valid until the next removal
+    T& operator[](const size_t index)
+    {
+        SDL_assert(index < m_items.size());
+        return m_items[index];
+    }
+
+    const T& operator[](const size_t index) const
+    {
+        SDL_assert(index < m_items.size());
+        return m_items[index];
+    }
+
+    // Returns invalid handle if pool is full
+    PoolHandle add(const T& item = T())
+    {
+        PoolHandle result;
+
+        if (m_items.size() >= m_maxSize)
+        {
+            return result;
+        }
+
+        if (NO_INDEX == m_freeSlot)
+        {
+            result.slot = Uint32(m_slots.size());
+            m_slots.push_back(Slot());
+        }
+        else
+        {
+            result.slot = m_freeSlot;
+            m_freeSlot  = m_slots[m_freeSlot].nextFree;
+        }
+
+        Slot& slot = m_slots[result.slot];
+        slot.dense    = Uint32(m_items.size());
+        slot.nextFree = NO_INDEX;
+
+        result.generation = slot.generation;
+
+        m_items.push_back(item);
+        m_itemSlots.push_back(result.slot);
+
+        return result;
+    }
+
+    bool isValid(const PoolHandle& handle) const
+    {
+        return handle.slot < m_slots.size()
+            && NO_INDEX != m_slots[handle.slot].dense
+            && handle.generation == m_slots[handle.slot].generation;
+    }
+
+    // Returns NULL if object was removed
+    T* get(const PoolHandle& handle)
+    {
+        return isValid(handle) ? &m_items[m_slots[handle.slot].dense] : NULL;
+    }
+
+    const T* get(const PoolHandle& handle) const
+    {
+        return isValid(handle) ? &m_items[m_slots[handle.slot].dense] : NULL;
+    }
+
+    PoolHandle handle(const size_t index) const
+    {
+        SDL_assert(index < m_items.size());
+
+        PoolHandle result;
+        result.slot       = m_itemSlots[index];
+        result.generation = m_slots[result.slot].generation;
+
+        return result;
+    }
+
+    void remove(const PoolHandle& handle)
+    {
+        if (isValid(handle))
+        {
+            removeAt(m_slots[handle.slot].dense);
+        }
+    }
+
+    // Removes object by dense index, the last object takes its place
+    void removeAt(const size_t index)
+    {
+        SDL_assert(index < m_items.size());
+
+        const Uint32 removedSlot = m_itemSlots[index];
+        const size_t lastIndex   = m_items.size() - 1;
+
+        if (index != lastIndex)
+        {
+            m_items[index]     = m_items[lastIndex];
+            m_itemSlots[index] = m_itemSlots[lastIndex];
+
+            m_slots[m_itemSlots[index]].dense = Uint32(index);
+        }
+
+        m_items.pop_back();
+        m_itemSlots.pop_back();
+
+        releaseSlot(removedSlot);
+    }
+
+    void clear()
+    {
+        for (size_t i = 0; i < m_itemSlots.size(); ++i)
+        {
+            releaseSlot(m_itemSlots[i]);
+        }
+
+        m_items.clear();
+        m_itemSlots.clear();
+    }
+
+private:
+    static const Uint32 NO_INDEX = 0xFFFFFFFF;
+
+    struct Slot
+    {
+        Uint32 dense;
+        Uint32 generation;
+        Uint32 nextFree;
+
+        Slot()
+        : dense(NO_INDEX)
+        , generation(0)
+        , nextFree(NO_INDEX)
+        {
+        }
+    };
+
+    std::vector<T>      m_items;
+    std::vector<Uint32> m_itemSlots;
+    std::vector<Slot>   m_slots;
+
+    size_t m_maxSize;
+    Uint32 m_freeSlot;
+
+    void releaseSlot(const Uint32 index)
+    {
+        Slot& slot = m_slots[index];
+        slot.dense    = NO_INDEX;
+        slot.nextFree = m_freeSlot;
+
+        // Outstanding handles to this slot become invalid
+        ++slot.generation;
+
+        m_freeSlot = index;
+    }
+};
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_POOL_H_INCLUDED
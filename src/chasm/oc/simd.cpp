@@ -0,0 +1,155 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/simd.h"
+
+#if defined(OC_SIMD_X86) && defined(_MSC_VER)
+#   include <intrin.h>
+#elif defined(OC_SIMD_X86)
+#   include <cpuid.h>
+#endif
+
+namespace OC
+{
+
+namespace
+{
+
+#ifdef OC_SIMD_X86
+
+void CPUID(const int leaf, int (&info)[4])
+{
+#ifdef _MSC_VER
+    __cpuidex(info, leaf, 0);
+#else
+    unsigned int eax, ebx, ecx, edx;
+    __cpuid_count(leaf, 0, eax, ebx, ecx, edx);
+
+    info[0] = int(eax);
+    info[1] = int(ebx);
+    info[2] = int(ecx);
+    info[3] = int(edx);
+#endif
+}
+
+Uint64 XGETBV()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    Uint32 eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+    return (Uint64(edx) << 32) | eax;
+#endif
+}
+
+bool HasAVX2()
+{
+    int info[4];
+
+    CPUID(0, info);
+
+    if (info[0] < 7)
+    {
+        return false;
+    }
+
+    CPUID(1, info);
+
+    const bool osxsave = 0 != (info[2] & (1 << 27));
+    const bool avx     = 0 != (info[2] & (1 << 28));
+
+    // OS must save and restore YMM registers
+    if (!osxsave || !avx || 6 != (XGETBV() & 6))
+    {
+        return false;
+    }
+
+    CPUID(7, info);
+
+    return 0 != (info[1] & (1 << 5));
+}
+
+#endif // OC_SIMD_X86
+
+} // unnamed namespace
+
+
+const char* SIMDName(const SIMDType type)
+{
+    static const char* const NAMES[SIMD_COUNT] =
+    {
+        "scalar",
+        "SSE2",
+        "AVX2",
+        "NEON"
+    };
+
+    SDL_assert(type < SIMD_COUNT);
+
+    return NAMES[type];
+}
+
+bool IsSIMDSupported(const SIMDType type)
+{
+    switch (type)
+    {
+        case SIMD_NONE:
+            return true;
+
+#ifdef OC_SIMD_X86
+        case SIMD_SSE2:
+            return SDL_TRUE == SDL_HasSSE2();
+
+        case SIMD_AVX2:
+        {
+            static const bool hasAVX2 = HasAVX2();
+            return hasAVX2;
+        }
+#endif // OC_SIMD_X86
+
+#ifdef OC_SIMD_NEON
+        case SIMD_NEON:
+            return true; // mandatory for AArch64
+#endif // OC_SIMD_NEON
+
+        default:
+            return false;
+    }
+}
+
+SIMDType BestSIMD()
+{
+    static const SIMDType ORDER[] = { SIMD_AVX2, SIMD_NEON, SIMD_SSE2 };
+
+    for (size_t i = 0; i < SDL_arraysize(ORDER); ++i)
+    {
+        if (IsSIMDSupported(ORDER[i]))
+        {
+            return ORDER[i];
+        }
+    }
+
+    return SIMD_NONE;
+}
+
+} // namespace OC
@@ -0,0 +1,71 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_SIMD_H_INCLUDED
+#define OPENCHASM_OC_SIMD_H_INCLUDED
+
+#include "oc/types.h"
+
+// Instruction sets which intrinsics are available at compile time
+// Actual support by CPU must be checked at runtime with IsSIMDSupported()
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#   define OC_SIMD_X86 1
+#   include <emmintrin.h>
+#   include <immintrin.h>
+#endif
+
+#if defined(_M_ARM64) || defined(__aarch64__)
+#   define OC_SIMD_NEON 1
+#   include <arm_neon.h>
+#endif
+
+// Enables instruction set for single function,
+// so the rest of code is compiled for baseline CPU
+#if defined(__GNUC__) || defined(__clang__)
+#   define OC_SIMD_TARGET(ISA) __attribute__((target(ISA)))
+#else
+#   define OC_SIMD_TARGET(ISA)
+#endif
+
+namespace OC
+{
+
+enum SIMDType
+{
+    SIMD_NONE,
+    SIMD_SSE2,
+    SIMD_AVX2,
+    SIMD_NEON,
+
+    SIMD_COUNT
+};
+
+const char* SIMDName(const SIMDType type);
+
+bool IsSIMDSupported(const SIMDType type);
+
+// The most capable instruction set supported by CPU
+SIMDType BestSIMD();
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_SIMD_H_INCLUDED
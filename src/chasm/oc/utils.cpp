@@ -56,7 +56,13 @@ void DoHalt(const char* const message)
         exit(EXIT_SUCCESS);
     }
 
-    SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Error", message, NULL);
+    SDL_LogCritical(SDL_LOG_CATEGORY_APPLICATION, "%s", message);
+
+    // No message box in headless mode
+    if (0 != SDL_WasInit(SDL_INIT_VIDEO))
+    {
+        SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_ERROR, "Fatal Error", message, NULL);
+    }
 
     exit(EXIT_FAILURE);
 }
@@ -0,0 +1,229 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#include "oc/workers.h"
+
+#include "oc/utils.h"
+
+namespace OC
+{
+
+namespace
+{
+
+// Upper limit for automatic thread count, more threads rarely pay off
+const int MAX_AUTO_THREADS = 16;
+
+} // unnamed namespace
+
+
+WorkerPool::WorkerPool()
+: m_mutex        (SDL_CreateMutex())
+, m_workCondition(SDL_CreateCond())
+, m_doneCondition(SDL_CreateCond())
+, m_task(NULL)
+, m_partCount(0)
+, m_taskNumber(0)
+, m_startTaskNumber(0)
+, m_busyWorkers(0)
+, m_quit(false)
+{
+    if (NULL == m_mutex || NULL == m_workCondition || NULL == m_doneCondition)
+    {
+        DoHaltSDLError("Failed to create worker pool synchronization objects.");
+    }
+
+    SDL_AtomicSet(&m_nextPart, 0);
+
+    setThreadCount(0);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopThreads();
+
+    SDL_DestroyCond(m_doneCondition);
+    SDL_DestroyCond(m_workCondition);
+    SDL_DestroyMutex(m_mutex);
+}
+
+
+void WorkerPool::setThreadCount(const int count)
+{
+    const int threads = count > 0 ? count : std::min(SDL_GetCPUCount(), MAX_AUTO_THREADS);
+
+    if (threads == threadCount() && !m_threads.empty())
+    {
+        return;
+    }
+
+    stopThreads();
+    startThreads(threads - 1);
+
+    SDL_Log("Worker pool uses %i threads", threadCount());
+}
+
+
+void WorkerPool::run(ParallelTask& task, const int partCount)
+{
+    if (partCount <= 0)
+    {
+        return;
+    }
+
+    if (m_threads.empty() || 1 == partCount)
+    {
+        for (int i = 0; i < partCount; ++i)
+        {
+            task.execute(i);
+        }
+
+        return;
+    }
+
+    SDL_LockMutex(m_mutex);
+
+    m_task      = &task;
+    m_partCount = partCount;
+    SDL_AtomicSet(&m_nextPart, 0);
+
+    ++m_taskNumber;
+    m_busyWorkers = int(m_threads.size());
+
+    SDL_CondBroadcast(m_workCondition);
+    SDL_UnlockMutex(m_mutex);
+
+    executeParts();
+
+    // Task must not be touched by workers after return
+    SDL_LockMutex(m_mutex);
+
+    while (m_busyWorkers > 0)
+    {
+        SDL_CondWait(m_doneCondition, m_mutex);
+    }
+
+    m_task = NULL;
+
+    SDL_UnlockMutex(m_mutex);
+}
+
+
+void WorkerPool::startThreads(const int count)
+{
+    SDL_assert(m_threads.empty());
+
+    m_quit = false;
+    m_startTaskNumber = m_taskNumber;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const String name = (Format("Worker %1%") % (i + 1)).str();
+        SDL_Thread* const thread = SDL_CreateThread(workerThread, name.c_str(), this);
+
+        if (NULL == thread)
+        {
+            DoHaltSDLError("Failed to create worker thread.");
+        }
+
+        m_threads.push_back(thread);
+    }
+}
+
+void WorkerPool::stopThreads()
+{
+    if (m_threads.empty())
+    {
+        return;
+    }
+
+    SDL_LockMutex(m_mutex);
+    m_quit = true;
+    SDL_CondBroadcast(m_workCondition);
+    SDL_UnlockMutex(m_mutex);
+
+    OC_FOREACH(SDL_Thread* const thread, m_threads)
+    {
+        SDL_WaitThread(thread, NULL);
+    }
+
+    m_threads.clear();
+}
+
+
+int SDLCALL WorkerPool::workerThread(void* data)
+{
+    static_cast<WorkerPool*>(data)->workerLoop();
+    return 0;
+}
+
+void WorkerPool::workerLoop()
+{
+    SDL_LockMutex(m_mutex);
+
+    Uint32 doneTask = m_startTaskNumber;
+
+    for (;;)
+    {
+        while (doneTask == m_taskNumber && !m_quit)
+        {
+            SDL_CondWait(m_workCondition, m_mutex);
+        }
+
+        if (m_quit)
+        {
+            break;
+        }
+
+        doneTask = m_taskNumber;
+
+        SDL_UnlockMutex(m_mutex);
+
+        executeParts();
+
+        SDL_LockMutex(m_mutex);
+
+        if (0 == --m_busyWorkers)
+        {
+            SDL_CondSignal(m_doneCondition);
+        }
+    }
+
+    SDL_UnlockMutex(m_mutex);
+}
+
+
+void WorkerPool::executeParts()
+{
+    for (;;)
+    {
+        const int part = SDL_AtomicAdd(&m_nextPart, 1);
+
+        if (part >= m_partCount)
+        {
+            break;
+        }
+
+        m_task->execute(part);
+    }
+}
+
+} // namespace OC
@@ -0,0 +1,90 @@
+
+/*
+ **---------------------------------------------------------------------------
+ ** OpenChasm - Free software reconstruction of Chasm: The Rift game
+ ** Copyright (C) 2013, 2014 Alexey Lysiuk
+ **
+ ** This program is free software: you can redistribute it and/or modify
+ ** it under the terms of the GNU General Public License as published by
+ ** the Free Software Foundation, either version 3 of the License, or
+ ** (at your option) any later version.
+ **
+ ** This program is distributed in the hope that it will be useful,
+ ** but WITHOUT ANY WARRANTY; without even the implied warranty of
+ ** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ ** GNU General Public License for more details.
+ **
+ ** You should have received a copy of the GNU General Public License
+ ** along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **---------------------------------------------------------------------------
+ */
+
+#ifndef OPENCHASM_OC_WORKERS_H_INCLUDED
+#define OPENCHASM_OC_WORKERS_H_INCLUDED
+
+#include "oc/types.h"
+
+namespace OC
+{
+
+// Work split into independent parts, which may be executed in any order and in parallel
+class ParallelTask
+{
+public:
+    virtual ~ParallelTask() { }
+
+    virtual void execute(const int part) = 0;
+};
+
+
+// ===========================================================================
+
+
+// Pool of threads sharing parallel tasks with calling thread
+// Parts of task are claimed one by one, so uneven parts are balanced
+
+class WorkerPool : public Singleton<WorkerPool>
+{
+public:
+    WorkerPool();
+    ~WorkerPool();
+
+    // Number of threads executing tasks, including calling one
+    int threadCount() const { return int(m_threads.size()) + 1; }
+    // Zero selects number of CPU cores
+    void setThreadCount(const int count);
+
+    // Executes all parts of task, returns when they are done
+    void run(ParallelTask& task, const int partCount);
+
+private:
+    std::vector<SDL_Thread*> m_threads;
+
+    SDL_mutex* m_mutex;
+    SDL_cond*  m_workCondition;
+    SDL_cond*  m_doneCondition;
+
+    ParallelTask* m_task;
+    int           m_partCount;
+    SDL_atomic_t  m_nextPart;
+
+    // Incremented for every task, so workers can tell new task from already done one
+    Uint32 m_taskNumber;
+    // Task number at the moment of threads start, threads may begin to run after new task
+    Uint32 m_startTaskNumber;
+    // Workers which didn't finish current task yet
+    int    m_busyWorkers;
+    bool   m_quit;
+
+    void startThreads(const int count);
+    void stopThreads();
+
+    static int SDLCALL workerThread(void* data);
+    void workerLoop();
+
+    void executeParts();
+};
+
+} // namespace OC
+
+#endif // OPENCHASM_OC_WORKERS_H_INCLUDED
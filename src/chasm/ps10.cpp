@@ -22,8 +22,12 @@
 #include "chasm.h"
 
 #include "oc/filesystem.h"
+#include "oc/governor.h"
 #include "oc/graphics.h"
+#include "oc/memory.h"
+#include "oc/pixels.h"
 #include "oc/utils.h"
+#include "oc/workers.h"
 
 #include "soundip/soundip.h"
 #include "cs3dm2.h"
@@ -70,32 +74,32 @@ void LoadConfig(const bool original)
 
     SoundIP::CDVolume = 8;
     
-    CSPBIO::MSsens = 10;
-    CSPBIO::Ms1ID = 0;
-    CSPBIO::Ms2ID = 1;
-
-    configFile >> CSPBIO::_FrontOn;
-    configFile >> CSPBIO::_BackOn;
-    configFile >> CSPBIO::_LeftOn;
-    configFile >> CSPBIO::_RightOn;
-    configFile >> CSPBIO::_SLeftOn;
-    configFile >> CSPBIO::_SRightOn;
-    configFile >> CSPBIO::_JumpOn;
-    configFile >> CSPBIO::_FireOn;
-    configFile >> CSPBIO::_ChangOn;
-    configFile >> CSPBIO::_StrafeOn;
-    configFile >> CSPBIO::_SpeedUpOn;
-    configFile >> CSPBIO::_MLookOn;
-    configFile >> CSPBIO::_MLookT;
-    configFile >> CSPBIO::_ViewUpOn;
-    configFile >> CSPBIO::_ViewCntrOn;
-    configFile >> CSPBIO::_ViewDnOn;
-
-    configFile >> CSPBIO::Ms1ID;
-    configFile >> CSPBIO::Ms2ID;
-    configFile >> CSPBIO::ms3id;
-
-    configFile >> CSPBIO::RespawnTime;
+    CSPBIO::Config.MSsens = 10;
+    CSPBIO::Config.Ms1ID = 0;
+    CSPBIO::Config.Ms2ID = 1;
+
+    configFile >> CSPBIO::Config._FrontOn;
+    configFile >> CSPBIO::Config._BackOn;
+    configFile >> CSPBIO::Config._LeftOn;
+    configFile >> CSPBIO::Config._RightOn;
+    configFile >> CSPBIO::Config._SLeftOn;
+    configFile >> CSPBIO::Config._SRightOn;
+    configFile >> CSPBIO::Config._JumpOn;
+    configFile >> CSPBIO::Config._FireOn;
+    configFile >> CSPBIO::Config._ChangOn;
+    configFile >> CSPBIO::Config._StrafeOn;
+    configFile >> CSPBIO::Config._SpeedUpOn;
+    configFile >> CSPBIO::Config._MLookOn;
+    configFile >> CSPBIO::Config._MLookT;
+    configFile >> CSPBIO::Config._ViewUpOn;
+    configFile >> CSPBIO::Config._ViewCntrOn;
+    configFile >> CSPBIO::Config._ViewDnOn;
+
+    configFile >> CSPBIO::Config.Ms1ID;
+    configFile >> CSPBIO::Config.Ms2ID;
+    configFile >> CSPBIO::Config.ms3id;
+
+    configFile >> CSPBIO::Config.RespawnTime;
 
     configFile >> SoundIP::FXVolume;
     configFile >> SoundIP::CDVolume;
@@ -103,27 +107,27 @@ void LoadConfig(const bool original)
     Uint16 brightness, contrast, color;
     Uint8 b0;
 
-    configFile >> CSPBIO::MSsens;
+    configFile >> CSPBIO::Config.MSsens;
     configFile >> brightness;
     configFile >> contrast;
     configFile >> color;
-    configFile >> CSPBIO::FloorW;
+    configFile >> CSPBIO::View.FloorW;
     configFile >> b0;
-    configFile >> CSPBIO::InfoPage;
+    configFile >> CSPBIO::Config.InfoPage;
 
     OC::BitmapManager::instance().setPaletteParameters(contrast, color, brightness);
 
     CSPBIO::b0 = b0; // ??? 2-byte variable but only one byte is read
 
-    configFile.readString(CSPBIO::SelfNick, 8);
-    configFile >> CSPBIO::SelfColor;
+    configFile.readString(CSPBIO::Config.SelfNick, 8);
+    configFile >> CSPBIO::Config.SelfColor;
 
     configFile >> CS3DM2::ShadowCount;
-    configFile >> CSPBIO::EpisodeReset;
-    configFile >> CSPBIO::Cocpit;
-    configFile >> CSPBIO::ReverseMouse;
-    configFile >> CSPBIO::MLookOn;
-    configFile >> CSPBIO::AlwaysRun;
+    configFile >> CSPBIO::Config.EpisodeReset;
+    configFile >> CSPBIO::Config.Cocpit;
+    configFile >> CSPBIO::Config.ReverseMouse;
+    configFile >> CSPBIO::Config.MLookOn;
+    configFile >> CSPBIO::Config.AlwaysRun;
 
     configFile >> CSPBIO::NGCard;
     configFile >> CSPBIO::NGPort;
@@ -140,67 +144,1040 @@ void LoadConfig(const bool original)
     {
         //SoundIP::SetVolumes();
 
-        //CSPBIO::ReInitViewConst();
+        if (0 != CSPBIO::View.VideoW)
+        {
+            CSPBIO::ReInitViewConst(CSPBIO::View.VideoW, CSPBIO::View.VideoH);
+        }
+    }
+}
+
+void CalcYMin(/*...*/);
+void StartPaint(/*...*/);
+
+namespace
+{
+
+void ApplyShade()
+{
+    OC::Renderer::instance().setTint(CSPBIO::Sim.RShadeLev, CSPBIO::Sim.GShadeLev, CSPBIO::Sim.BShadeLev);
+}
+
+} // unnamed namespace
+
+void UpDateRedShade()
+{
+    if (CSPBIO::Sim.RShadeLev != CSPBIO::Sim.LastRShadeLev)
+    {
+        CSPBIO::Sim.LastRShadeLev = CSPBIO::Sim.RShadeLev;
+
+        ApplyShade();
+    }
+}
+
+void UpDateGreenShade()
+{
+    if (CSPBIO::Sim.GShadeLev != CSPBIO::Sim.LastGShadeLev)
+    {
+        CSPBIO::Sim.LastGShadeLev = CSPBIO::Sim.GShadeLev;
+
+        ApplyShade();
+    }
+}
+
+void UpdateBlueShade()
+{
+    if (CSPBIO::Sim.BShadeLev != CSPBIO::Sim.LastBShadeLev)
+    {
+        CSPBIO::Sim.LastBShadeLev = CSPBIO::Sim.BShadeLev;
+
+        ApplyShade();
+    }
+}
+
+void DrawItems(/*...*/);
+
+void EndPaint()
+{
+    OC::Renderer::instance().present();
+
+    // Transient list filled by Expand*() functions is no longer needed, its capacity is kept
+    CSPBIO::FramesList.clear();
+}
+
+// Entity expansion starts with CSPBIO::IsVisibleFromView() test of entity position
+bool ExpandWall(/*...*/);
+void ExpandFrame(/*...*/);
+bool ExpandPicture(/*...*/);
+void ExpandObject(/*...*/);
+void DrawHoles(/*...*/);
+void Expand3dObject(/*...*/);
+void ExpandRocket(/*...*/);
+void ExpandMine(/*...*/);
+void ExpandSepPart(/*...*/);
+void ExpandAmmoBag(/*...*/);
+void ExpandBlow(/*...*/);
+void ExpandPlayer(/*...*/);
+void ExpandMonster(/*...*/);
+void MapXY(/*...*/);
+void MoveRocket(/*...*/);
+void AnimateRockets(/*...*/);
+bool GetNearestWall(/*...*/);
+void AddClientProcesses(/*...*/);
+void AnimateSwitches(/*...*/);
+void MakeTeleBlow(/*...*/);
+void CheckTelePorts(/*...*/);
+void CheckFloorLinks(/*...*/);
+void DeinitMonitor(/*...*/);
+void SwitchMonitor(/*...*/);
+
+void ReInitOwners()
+{
+    CSPBIO::CurOwner = 0;
+
+    for (size_t i = 0; i < CSPBIO::VideoOwners.size(); ++i)
+    {
+        CSPBIO::VideoOwners[i] = Uint8(i + 1);
+    }
+}
+
+void InsertPlayers(/*...*/);
+void NewGame(/*...*/);
+void MenuStartNet(/*...*/);
+void MenuJoinNet(/*...*/);
+
+namespace
+{
+
+void ShowMemoryStats()
+{
+    for (int i = 0; i < OC::MemoryStats::CATEGORY_COUNT; ++i)
+    {
+        const OC::MemoryStats::Category category = OC::MemoryStats::Category(i);
+
+        CSPBIO::PutConsMessage((OC::Format("%1%: %2% KB, peak %3% KB")
+            % OC::MemoryStats::name(category)
+            % (OC::MemoryStats::current(category) / 1024)
+            % (OC::MemoryStats::peak(category) / 1024)).str());
+    }
+}
+
+void DumpMemoryStats()
+{
+    static const char* const FILENAME = "memstat.json";
+
+    const OC::Path dumpPath = OC::FileSystem::instance().userPath(FILENAME);
+    OC::BinaryFile dumpFile(dumpPath, std::ios::out | std::ios::trunc);
+
+    if (!dumpFile.is_open())
+    {
+        CSPBIO::PutConsMessage((OC::Format("Failed to write %1%") % FILENAME).str());
+        return;
+    }
+
+    const OC::String json = OC::MemoryStats::toJSON();
+    dumpFile.write(json.data(), std::streamsize(json.size()));
+
+    CSPBIO::PutConsMessage((OC::Format("Memory statistics saved to %1%") % FILENAME).str());
+}
+
+
+// Each quality level lowers resolution further, it's the only setting game renderer follows
+struct QualityLevel
+{
+    const char* Name;
+    int Percent;
+};
+
+const QualityLevel QUALITY_LEVELS[] =
+{
+    { "full resolution", 100 },
+    { "85% resolution",   85 },
+    { "70% resolution",   70 },
+    { "60% resolution",   60 },
+    { "50% resolution",   50 },
+};
+
+OC::QualityGovernor Governor(int(SDL_arraysize(QUALITY_LEVELS)));
+
+// Video mode chosen by user, used by the best quality level
+Uint16 UserVideoW;
+Uint16 UserVideoH;
+
+void SaveUserQuality()
+{
+    UserVideoW = CSPBIO::View.VideoW;
+    UserVideoH = CSPBIO::View.VideoH;
+}
+
+void ApplyQuality(const int level)
+{
+    const int percent = QUALITY_LEVELS[level].Percent;
+
+    const Uint16 width  = std::max(CSPBIO::MIN_VIDEO_WIDTH,  Uint16(UserVideoW * percent / 100));
+    const Uint16 height = std::max(CSPBIO::MIN_VIDEO_HEIGHT, Uint16(UserVideoH * percent / 100));
+
+    // Mode change is expensive, so it is done only when resolution differs
+    if (width != CSPBIO::View.VideoW || height != CSPBIO::View.VideoH)
+    {
+        CSPBIO::SetVideoMode(width, height);
+    }
+}
+
+void ShowQuality()
+{
+    if (!Governor.isEnabled())
+    {
+        CSPBIO::PutConsMessage("Quality governor is off, usage: governor MILLISECONDS");
+        return;
+    }
+
+    CSPBIO::PutConsMessage((OC::Format("Quality %1% (%2%), frame %3$.2f ms, target %4$.2f ms")
+        % Governor.level() % QUALITY_LEVELS[Governor.level()].Name
+        % Governor.averageFrameTime() % Governor.target()).str());
+}
+
+} // unnamed namespace
+
+void SetQualityTarget(const OC::Double milliseconds)
+{
+    // Return to user settings before the new measurements
+    if (Governor.isEnabled())
+    {
+        ApplyQuality(0);
+    }
+
+    Governor.setTarget(milliseconds);
+
+    if (Governor.isEnabled())
+    {
+        SaveUserQuality();
+    }
+}
+
+void UpdateQuality(const OC::Double frameTime)
+{
+    const OC::Double average = Governor.averageFrameTime();
+
+    if (Governor.update(frameTime))
+    {
+        ApplyQuality(Governor.level());
+
+        CSPBIO::PutConsMessage((OC::Format("Quality %1% (%2%), frame %3$.2f ms")
+            % Governor.level() % QUALITY_LEVELS[Governor.level()].Name % average).str());
+    }
+}
+
+void ExecConsole(const OC::String& command)
+{
+    const OC::String name = boost::algorithm::to_lower_copy(boost::algorithm::trim_copy(command));
+
+    if ("memstat" == name)
+    {
+        ShowMemoryStats();
+    }
+    else if ("memdump" == name)
+    {
+        DumpMemoryStats();
+    }
+    else if (boost::algorithm::starts_with(name, "vmode"))
+    {
+        int width, height;
+
+        if (2 == SDL_sscanf(name.c_str(), "vmode %dx%d", &width, &height) && width > 0 && height > 0)
+        {
+            // Governor returns to user settings first, otherwise the best quality level
+            // would restore the previous mode, then the new mode becomes user choice
+            const OC::Double target = Governor.target();
+            SetQualityTarget(0.0);
+
+            CSPBIO::SetVideoMode(Uint16(std::min(width, 0xFFFF)), Uint16(std::min(height, 0xFFFF)));
+
+            SetQualityTarget(target);
+        }
+        else
+        {
+            CSPBIO::PutConsMessage((OC::Format("Mode: %1%x%2%, usage: vmode WIDTHxHEIGHT")
+                % CSPBIO::View.VideoW % CSPBIO::View.VideoH).str());
+        }
+    }
+    else if (boost::algorithm::starts_with(name, "governor"))
+    {
+        double target;
+
+        if (1 == SDL_sscanf(name.c_str(), "governor %lf", &target) && target >= 0.0)
+        {
+            SetQualityTarget(target);
+        }
+
+        ShowQuality();
+    }
+    else
+    {
+        CSPBIO::PutConsMessage("Unknown command: " + command);
+    }
+}
+
+void ProcessConsole(const SDL_Event& event)
+{
+    CSPBIO::TConfigState& config = CSPBIO::Config;
+
+    if (SDL_KEYDOWN == event.type && SDLK_BACKQUOTE == event.key.keysym.sym)
+    {
+        config.Console = !config.Console;
+
+        if (config.Console)
+        {
+            SDL_StartTextInput();
+        }
+        else
+        {
+            SDL_StopTextInput();
+        }
+
+        return;
+    }
+
+    if (!config.Console)
+    {
+        return;
+    }
+
+    // The last console line is the one being edited
+    OC::String& line = CSPBIO::ConsoleComm.back();
+
+    if (SDL_TEXTINPUT == event.type)
+    {
+        // Text of the key opening console is not a part of command
+        if ('`' != event.text.text[0])
+        {
+            line += event.text.text;
+        }
+    }
+    else if (SDL_KEYDOWN == event.type)
+    {
+        switch (event.key.keysym.sym)
+        {
+            case SDLK_BACKSPACE:
+                // Remove the whole UTF-8 sequence of the last character
+                while (!line.empty() && 0x80 == (line[line.size() - 1] & 0xC0))
+                {
+                    line.erase(line.size() - 1);
+                }
+
+                if (!line.empty())
+                {
+                    line.erase(line.size() - 1);
+                }
+                break;
+
+            case SDLK_RETURN:
+            case SDLK_KP_ENTER:
+                {
+                    const OC::String command = line;
+                    line.clear();
+
+                    if (!command.empty())
+                    {
+                        CSPBIO::PutConsMessage("> " + command);
+                        ExecConsole(command);
+                    }
+                }
+                break;
+
+            case SDLK_ESCAPE:
+                config.Console = false;
+                SDL_StopTextInput();
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
+void LeftRight(/*...*/);
+void LR_Roll(/*...*/);
+void LookForLevel(/*...*/);
+void RemoveMouse(/*...*/);
+void ProcessMenu(/*...*/);
+
+namespace
+{
+
+// Map coordinates have 256 units per cell
+const int CELL_SHIFT = 8;
+const int MAP_SIZE   = 64;
+
+// Columns rendered by one part of parallel task
+// All strips share CSPBIO::Coverage, each one writes and reads only its own columns
+// and groups, so strip boundaries must never split a coarse coverage group
+const int STRIP_WIDTH = 64;
+
+SDL_COMPILE_TIME_ASSERT(strip_width, 0 == STRIP_WIDTH % (1 << OC::CoverageBuffer::COARSE_SHIFT));
+
+// Shading levels added per cell of distance and for walls facing north or south
+const OC::Double DISTANCE_SHADE = 1.5;
+const int SIDE_SHADE = 2;
+
+// Glass walls passed by ray before it stops at opaque one
+const int MAX_GLASS_LAYERS = 4;
+
+// Translucent wall column deferred until opaque walls, floor and ceiling are drawn
+struct TGlassLayer
+{
+    TWallColumn Column;
+    Sint32 Depth;   // distance, 16.16 fixed point in cells
+    Sint16 X;       // screen column
+    Uint8 Texture;  // index of wall texture plus one
+};
+
+// Farther layers are drawn first
+bool IsFartherLayer(const TGlassLayer& first, const TGlassLayer& second)
+{
+    return first.Depth > second.Depth;
+}
+
+// Column range of viewport with its own wall buffers and columns of coverage buffer,
+// so strips are rendered in parallel without sharing writable state
+struct TViewStrip
+{
+    int X1;
+    int X2;
+
+    std::vector<TWallColumn> Columns;
+    // Index of wall texture plus one, zero when column has no wall
+    std::vector<Uint8> Textures;
+
+    // Glass walls of all columns, refilled every frame
+    std::vector<TGlassLayer> Glass;
+};
+
+// Raycasting renderer of world view
+// Map, wall textures and light levels are shared by all strips and read only
+
+class SceneRenderer : public OC::ParallelTask
+{
+public:
+    SceneRenderer();
+
+    void render(OC::Bitmap& target);
+
+    virtual void execute(const int part);
+
+private:
+    std::vector<TViewStrip> m_strips;
+
+    // Floor or ceiling span of every view row, clipped by strips
+    std::vector<TFloorSpan> m_spans;
+    TFloorTextures m_floors;
+    int m_floorDetail;
+
+    Uint8* m_pixels;
+    int    m_pitch;
+
+    // Camera in map cells
+    OC::Double m_positionX;
+    OC::Double m_positionY;
+    OC::Double m_directionX;
+    OC::Double m_directionY;
+    OC::Double m_planeX;
+    OC::Double m_planeY;
+
+    void castColumn(const int x, TViewStrip& strip, const int index) const;
+    void projectWall(const CSPBIO::TLoc& cell, const int side, const OC::Double distance,
+        const OC::Double rayX, const OC::Double rayY, TWallColumn& column) const;
+    void drawFloors(const TViewStrip& strip, const int y, Uint8* const row) const;
+    void drawWalls(const TViewStrip& strip) const;
+    void drawGlass(TViewStrip& strip) const;
+};
+
+SceneRenderer Scene;
+
+
+SceneRenderer::SceneRenderer()
+: m_floorDetail(0)
+, m_pixels(NULL)
+, m_pitch(0)
+, m_positionX(0.0)
+, m_positionY(0.0)
+, m_directionX(1.0)
+, m_directionY(0.0)
+, m_planeX(0.0)
+, m_planeY(1.0)
+{
+    SDL_zero(m_floors);
+}
+
+void SceneRenderer::render(OC::Bitmap& target)
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+
+    SDL_assert(view.WinSX + view.WinW <= target.width());
+    SDL_assert(view.WinSY + view.WinH <= target.height());
+
+    m_pixels = target.pixels();
+    m_pitch  = target.pitch();
+
+    const CSPBIO::TPlayerInfo& player = CSPBIO::Players[CSPBIO::MyNetN];
+
+    m_positionX = OC::Double(player.PlHx) / (1 << CELL_SHIFT);
+    m_positionY = OC::Double(player.PlHy) / (1 << CELL_SHIFT);
+
+    // Entities are expanded for rendering only in cells visible from camera cell
+    const int viewX = std::max(0, std::min(player.PlHx >> CELL_SHIFT, MAP_SIZE - 1));
+    const int viewY = std::max(0, std::min(player.PlHy >> CELL_SHIFT, MAP_SIZE - 1));
+    CSPBIO::Render.ViewCell = Uint16(viewX * MAP_SIZE + viewY);
+
+    // Full circle is 65536 units of angle, field of view is 90 degrees
+    const OC::Double angle = CSPBIO::Sim.HFi * M_PI / 32768.0;
+
+    m_directionX = SDL_cos(angle);
+    m_directionY = SDL_sin(angle);
+    m_planeX     = -m_directionY;
+    m_planeY     =  m_directionX;
+
+    // Sky replaces ceiling of the whole level
+    BuildSky();
+
+    // Without textures floor and ceiling are flat
+    const OC::Bitmap& floors = CSPBIO::Floors;
+    SDL_assert(!floors.isValid() || FLOOR_TILE_SIZE == floors.pitch());
+
+    m_floors.Tiles     = floors.isValid() ? floors.pixels() : NULL;
+    m_floors.TileIndex = CSPBIO::FlSegs;
+    m_floors.FloorMap  = CSPBIO::FloorMap;
+    m_floors.CellMap   = CSPBIO::CellMap;
+    m_floors.ColorMap  = CSPBIO::ColorMap.pixels();
+
+    m_floorDetail = 0;
+
+    while (0 != view.FloorW && m_floorDetail < 2 && (view.WinW >> m_floorDetail) > view.FloorW)
+    {
+        ++m_floorDetail;
+    }
+
+    // Map position seen at screen row changes linearly across the row
+    SDL_assert(CSPBIO::FloorDist.size() > view.WinEY);
+    m_spans.resize(view.WinH);
+
+    const OC::Double cameraX0 = 2.0 * (0.5 - view.WinSX) / view.WinW - 1.0;
+    const OC::Double cameraStep = 2.0 / view.WinW;
+
+    const OC::Bitmap& colorMap = CSPBIO::ColorMap;
+
+    for (int y = view.WinSY; y <= view.WinEY; ++y)
+    {
+        const OC::Double distance = CSPBIO::FloorDist[y] / 65536.0;
+
+        TFloorSpan& span = m_spans[y - view.WinSY];
+
+        span.U     = Sint32((m_positionX + distance * (m_directionX + m_planeX * cameraX0)) * 65536.0);
+        span.V     = Sint32((m_positionY + distance * (m_directionY + m_planeY * cameraX0)) * 65536.0);
+        span.DU    = Sint32(distance * m_planeX * cameraStep * 65536.0);
+        span.DV    = Sint32(distance * m_planeY * cameraStep * 65536.0);
+        span.Shade = std::min(int(distance * DISTANCE_SHADE), colorMap.height() - 1) * colorMap.pitch();
+    }
+
+    SDL_assert(CSPBIO::Coverage.width() >= view.WinW);
+
+    const int stripCount = (view.WinW + STRIP_WIDTH - 1) / STRIP_WIDTH;
+
+    m_strips.resize(stripCount);
+
+    for (int i = 0; i < stripCount; ++i)
+    {
+        TViewStrip& strip = m_strips[i];
+
+        strip.X1 = view.WinSX + i * STRIP_WIDTH;
+        strip.X2 = std::min(strip.X1 + STRIP_WIDTH, view.WinSX + view.WinW);
+
+        const size_t width = size_t(strip.X2 - strip.X1);
+
+        strip.Columns   .resize(width);
+        strip.Textures  .resize(width);
+    }
+
+    OC::WorkerPool::instance().run(*this, stripCount);
+}
+
+void SceneRenderer::execute(const int part)
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+    TViewStrip& strip = m_strips[part];
+    strip.Glass.clear();
+
+    for (int x = strip.X1; x < strip.X2; ++x)
+    {
+        castColumn(x, strip, x - strip.X1);
+    }
+
+    CSPBIO::Coverage.updateGroups(strip.X1 - view.WinSX, strip.X2 - view.WinSX);
+
+    // Ceiling and floor are drawn by rows of strip
+    Uint8* row = m_pixels + view.WinSY * m_pitch;
+
+    for (int y = view.WinSY; y <= view.WinEY; ++y)
+    {
+        drawFloors(strip, y, row);
+
+        row += m_pitch;
+    }
+
+    drawWalls(strip);
+    drawGlass(strip);
+}
+
+void SceneRenderer::castColumn(const int x, TViewStrip& strip, const int index) const
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+
+    OC::CoverageBuffer& coverage = CSPBIO::Coverage;
+    const int viewX = x - view.WinSX;
+
+    coverage.setColumn(viewX, Sint16(view.WinCY), Sint16(view.WinCY), std::numeric_limits<Sint32>::max());
+    strip.Textures[index] = 0;
+
+    const OC::Double cameraX = 2.0 * (x - view.WinSX + 0.5) / view.WinW - 1.0;
+
+    const OC::Double rayX = m_directionX + m_planeX * cameraX;
+    const OC::Double rayY = m_directionY + m_planeY * cameraX;
+
+    // Digital differential analyzer walks through map cells crossed by ray
+    const OC::Double deltaX = 0.0 == rayX ? 1e30 : SDL_fabs(1.0 / rayX);
+    const OC::Double deltaY = 0.0 == rayY ? 1e30 : SDL_fabs(1.0 / rayY);
+
+    int cellX = int(SDL_floor(m_positionX));
+    int cellY = int(SDL_floor(m_positionY));
+
+    const int stepX = rayX < 0.0 ? -1 : 1;
+    const int stepY = rayY < 0.0 ? -1 : 1;
+
+    OC::Double sideX = (rayX < 0.0 ? m_positionX - cellX : cellX + 1.0 - m_positionX) * deltaX;
+    OC::Double sideY = (rayY < 0.0 ? m_positionY - cellY : cellY + 1.0 - m_positionY) * deltaY;
+
+    int side = 0;
+    int glassLayers = 0;
+
+    for (int i = 0; i < MAP_SIZE * 2; ++i)
+    {
+        if (sideX < sideY)
+        {
+            sideX += deltaX;
+            cellX += stepX;
+            side = 0;
+        }
+        else
+        {
+            sideY += deltaY;
+            cellY += stepY;
+            side = 1;
+        }
+
+        if (cellX < 0 || cellX >= MAP_SIZE || cellY < 0 || cellY >= MAP_SIZE)
+        {
+            return;
+        }
+
+        const CSPBIO::TLoc& cell = CSPBIO::Map[cellX * MAP_SIZE + cellY];
+
+        if (cell.Spr < 1 || cell.Spr > CSPBIO::PImPtr.size() || !CSPBIO::PImPtr[cell.Spr - 1].isValid())
+        {
+            continue;
+        }
+
+        const OC::Double distance = std::max(0 == side ? sideX - deltaX : sideY - deltaY, 1.0 / 256.0);
+        const Sint32 depth = Sint32(std::min(distance * 65536.0, OC::Double(std::numeric_limits<Sint32>::max())));
+
+        // Glass walls don't stop the ray, they are blended over everything behind them later,
+        // the ray stops at glass wall when there are too many of them
+        if (0 == (CSPBIO::WallMask[cell.Spr - 1] & 1) && glassLayers < MAX_GLASS_LAYERS)
+        {
+            TGlassLayer layer;
+            layer.Depth   = depth;
+            layer.X       = Sint16(x);
+            layer.Texture = cell.Spr;
+
+            projectWall(cell, side, distance, rayX, rayY, layer.Column);
+
+            if (layer.Column.Y1 < layer.Column.Y2)
+            {
+                strip.Glass.push_back(layer);
+                ++glassLayers;
+            }
+
+            continue;
+        }
+
+        TWallColumn& column = strip.Columns[index];
+        projectWall(cell, side, distance, rayX, rayY, column);
+
+        coverage.setColumn(viewX, column.Y1, column.Y2, depth);
+        strip.Textures[index] = cell.Spr;
+        return;
+    }
+}
+
+void SceneRenderer::projectWall(const CSPBIO::TLoc& cell, const int side, const OC::Double distance,
+    const OC::Double rayX, const OC::Double rayY, TWallColumn& column) const
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+
+    // Texture rows are image columns, see Bitmap::createColumnMajor()
+    // Wall height spans the image, padding of rows is used only for wrapping
+    const OC::Bitmap& texture = CSPBIO::PImPtr[cell.Spr - 1];
+    const int textureWidth  = texture.height();
+    const int textureLength = texture.columnLength();
+
+    OC::Double hit = 0 == side ? m_positionY + distance * rayY : m_positionX + distance * rayX;
+    hit -= SDL_floor(hit);
+
+    int textureX = std::min(int(hit * textureWidth), textureWidth - 1);
+
+    if ((0 == side && rayX > 0.0) || (1 == side && rayY < 0.0))
+    {
+        textureX = textureWidth - 1 - textureX;
+    }
+
+    // Walls are one cell high, with eye in the middle
+    const OC::Double height = view.WinW2 / distance;
+    const OC::Double top = view.WinCY - height / 2.0;
+
+    const int y1 = std::max(int(SDL_ceil(top)), int(view.WinSY));
+    const int y2 = std::min(int(SDL_ceil(top + height)), view.WinEY + 1);
+
+    const OC::Bitmap& colorMap = CSPBIO::ColorMap;
+    const int shade = std::min(cell.Dark + int(distance * DISTANCE_SHADE) + side * SIDE_SHADE,
+        colorMap.height() - 1);
+
+    const OC::Double step = textureLength / height;
+
+    column.Offset = textureX * texture.pitch();
+    column.V      = Sint32((y1 - top) * step * 65536.0);
+    column.DV     = Sint32(step * 65536.0);
+    column.Shade  = shade * colorMap.pitch();
+    column.Y1     = Sint16(y1);
+    column.Y2     = Sint16(std::max(y1, y2));
+}
+
+void SceneRenderer::drawFloors(const TViewStrip& strip, const int y, Uint8* const row) const
+{
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+    const OC::CoverageBuffer& coverage = CSPBIO::Coverage;
+
+    // Coverage is indexed by view columns
+    const int x1 = strip.X1 - view.WinSX;
+    const int x2 = strip.X2 - view.WinSX;
+
+    const bool ceiling = y < view.WinCY;
+
+    TFloorSpan span = m_spans[y - view.WinSY];
+
+    // Adjacent columns not covered by walls are drawn as one span,
+    // groups of covered columns are skipped at once
+    for (int begin = coverage.findOpen(x1, x2, y); begin < x2; begin = coverage.findOpen(begin, x2, y))
+    {
+        int end = begin + 1;
+
+        while (end < x2 && !coverage.isCovered(end, y))
+        {
+            ++end;
+        }
+
+        span.X1 = Sint16(view.WinSX + begin);
+        span.X2 = Sint16(view.WinSX + end);
+
+        if (ceiling && CSPBIO::Render.SkyVisible)
+        {
+            ShowSky(row + view.WinSX, y - view.WinSY, begin, end);
+        }
+        else if (NULL == m_floors.Tiles)
+        {
+            std::fill(row + span.X1, row + span.X2, 0);
+        }
+        else if (ceiling)
+        {
+            CellVHi(row, m_floors, span, m_floorDetail);
+        }
+        else
+        {
+            FloorVHi(row, m_floors, span, m_floorDetail);
+        }
+
+        begin = end;
+    }
+}
+
+void SceneRenderer::drawWalls(const TViewStrip& strip) const
+{
+    const int width = strip.X2 - strip.X1;
+
+    // Adjacent columns with the same texture are drawn as one segment
+    for (int begin = 0; begin < width; )
+    {
+        const Uint8 textureIndex = strip.Textures[begin];
+
+        int end = begin + 1;
+
+        while (end < width && textureIndex == strip.Textures[end])
+        {
+            ++end;
+        }
+
+        if (0 != textureIndex)
+        {
+            const OC::Bitmap& texture = CSPBIO::PImPtr[textureIndex - 1];
+
+            TWallSegment segment;
+            segment.Texture     = texture.pixels();
+            segment.RowShift    = 0;
+            segment.VMask       = texture.width() - 1;
+            segment.ColorMap    = CSPBIO::ColorMap.pixels();
+            segment.Transparent = false;
+
+            ShowSegment(m_pixels, m_pitch, strip.X1 + begin, segment, &strip.Columns[begin], end - begin);
+        }
+
+        begin = end;
     }
 }
 
-void CalcYMin(/*...*/);
-void StartPaint(/*...*/);
-void UpDateRedShade(/*...*/);
-void UpDateGreenShade(/*...*/);
-void UpdateBlueShade(/*...*/);
-void DrawItems(/*...*/);
-void EndPaint(/*...*/);
-bool ExpandWall(/*...*/);
-void ExpandFrame(/*...*/);
-bool ExpandPicture(/*...*/);
-void ExpandObject(/*...*/);
-void DrawHoles(/*...*/);
-void Expand3dObject(/*...*/);
-void ExpandRocket(/*...*/);
-void ExpandMine(/*...*/);
-void ExpandSepPart(/*...*/);
-void ExpandAmmoBag(/*...*/);
-void ExpandBlow(/*...*/);
-void ExpandPlayer(/*...*/);
-void ExpandMonster(/*...*/);
-void MapXY(/*...*/);
-void MoveRocket(/*...*/);
-void AnimateRockets(/*...*/);
-bool GetNearestWall(/*...*/);
-void AddClientProcesses(/*...*/);
-void AnimateSwitches(/*...*/);
-void MakeTeleBlow(/*...*/);
-void CheckTelePorts(/*...*/);
-void CheckFloorLinks(/*...*/);
-void DeinitMonitor(/*...*/);
-void SwitchMonitor(/*...*/);
-
-void ReInitOwners()
+void SceneRenderer::drawGlass(TViewStrip& strip) const
 {
-    CSPBIO::CurOwner = 0;
+    if (strip.Glass.empty())
+    {
+        return;
+    }
 
-    for (size_t i = 0; i < CSPBIO::VideoOwners.size(); ++i)
+    // Back to front order keeps layers of every column blended correctly,
+    // every layer blends its column once through the single blend table
+    std::stable_sort(strip.Glass.begin(), strip.Glass.end(), IsFartherLayer);
+
+    // Walls have no glass mode of their own, InversGlass turns 60% table into 40% one
+    // RGBTab25 serves Glass25 and Glass75 modes of blow sprites, see TBlowInfo::GlassMode
+    const Uint8* const blendTable = &CSPBIO::RGBTab60[0];
+
+    TWallSegment segment;
+    segment.RowShift    = 0;
+    segment.ColorMap    = CSPBIO::ColorMap.pixels();
+    segment.Transparent = true;
+
+    Uint8 textureIndex = 0;
+
+    OC_FOREACH(const TGlassLayer& layer, strip.Glass)
     {
-        CSPBIO::VideoOwners[i] = Uint8(i + 1);
+        if (textureIndex != layer.Texture)
+        {
+            textureIndex = layer.Texture;
+
+            const OC::Bitmap& texture = CSPBIO::PImPtr[textureIndex - 1];
+
+            segment.Texture = texture.pixels();
+            segment.VMask   = texture.width() - 1;
+        }
+
+        ShowGlassLine(m_pixels, m_pitch, layer.X, segment, layer.Column, blendTable);
     }
 }
 
-void InsertPlayers(/*...*/);
-void NewGame(/*...*/);
-void MenuStartNet(/*...*/);
-void MenuJoinNet(/*...*/);
-void ExecConsole(/*...*/);
-void ProcessConsole(/*...*/);
-void LeftRight(/*...*/);
-void LR_Roll(/*...*/);
-void LookForLevel(/*...*/);
-void RemoveMouse(/*...*/);
-void ProcessMenu(/*...*/);
+} // unnamed namespace
 
 void Build3dScene()
 {
-    // TODO ...
+    const CSPBIO::TViewConst& view = CSPBIO::View;
+    OC::Renderer& renderer = OC::Renderer::instance();
+
+    Scene.render(renderer.screen());
+
+    renderer.invalidate(OC::Rect(view.WinSX, view.WinSY, view.WinW, view.WinH));
+}
+
+void BenchmarkScene()
+{
+    static const int WIDTH  = 1920;
+    static const int HEIGHT = 1080;
+
+    static const int THREAD_COUNTS[] = { 1, 2, 4, 8 };
+
+    static const int TEXTURE_COUNT = 8;
+    static const int TEXTURE_SIZE  = 64;
+
+    static const int SKY_WIDTH  = 256;
+    static const int SKY_HEIGHT = 128;
+
+    // Minimal measurement time for each thread count, in seconds
+    static const OC::Double MEASURE_TIME = 0.5;
+
+    // Synthetic level replaces map, wall and floor textures, sky and color map, benchmark is run before game start
+    for (int i = 0; i < TEXTURE_COUNT; ++i)
+    {
+        OC::Bitmap image;
+        image.create(TEXTURE_SIZE, TEXTURE_SIZE);
+
+        for (int y = 0; y < TEXTURE_SIZE; ++y)
+        {
+            for (int x = 0; x < TEXTURE_SIZE; ++x)
+            {
+                image.setPixel(Uint16(x), Uint16(y), Uint8(rand() % 255));
+            }
+        }
+
+        CSPBIO::PImPtr[i].createColumnMajor(image, OC::Bitmap::SCOPE_LEVEL);
+        image.release();
+    }
+
+    CSPBIO::Floors.create(FLOOR_TILE_SIZE, FLOOR_TILE_SIZE * TEXTURE_COUNT, OC::Bitmap::SCOPE_LEVEL);
+
+    for (int y = 0; y < CSPBIO::Floors.height(); ++y)
+    {
+        for (int x = 0; x < CSPBIO::Floors.width(); ++x)
+        {
+            CSPBIO::Floors.setPixel(Uint16(x), Uint16(y), Uint8(rand()));
+        }
+    }
+
+    for (size_t i = 0; i < SDL_arraysize(CSPBIO::FlSegs); ++i)
+    {
+        CSPBIO::FlSegs[i] = Uint16(i % TEXTURE_COUNT);
+    }
+
+    for (size_t i = 0; i < SDL_arraysize(CSPBIO::FloorMap); ++i)
+    {
+        CSPBIO::FloorMap[i] = Uint8(rand());
+        CSPBIO::CellMap [i] = Uint8(rand());
+    }
+
+    CSPBIO::ColorMap.create(256, 64);
+
+    for (int y = 0; y < CSPBIO::ColorMap.height(); ++y)
+    {
+        for (int x = 0; x < CSPBIO::ColorMap.width(); ++x)
+        {
+            CSPBIO::ColorMap.setPixel(Uint16(x), Uint16(y), Uint8(rand()));
+        }
+    }
+
+    for (int x = 0; x < MAP_SIZE; ++x)
+    {
+        for (int y = 0; y < MAP_SIZE; ++y)
+        {
+            CSPBIO::TLoc& location = CSPBIO::Map[x * MAP_SIZE + y];
+
+            const bool border = 0 == x || 0 == y || MAP_SIZE - 1 == x || MAP_SIZE - 1 == y;
+
+            location.Spr  = border || 0 == rand() % 12 ? Uint8(1 + rand() % TEXTURE_COUNT) : 0;
+            location.Dark = Uint8(4 + rand() % 16);
+        }
+    }
+
+    CSPBIO::TLoc& start = CSPBIO::Map[MAP_SIZE / 2 * MAP_SIZE + MAP_SIZE / 2];
+    start.Spr = 0;
+
+    // Blend table averages colors, color 255 is transparent like in the real one
+    for (int i = 0; i < 256; ++i)
+    {
+        for (int j = 0; j < 256; ++j)
+        {
+            CSPBIO::RGBTab60[(i << 8) + j] = 0xFF == i ? Uint8(j) : 0xFF == j ? Uint8(i) : Uint8((i + j) / 2);
+        }
+    }
+
+    CSPBIO::WallMask.fill(7);
+
+    CSPBIO::TPlayerInfo& player = CSPBIO::Players[CSPBIO::MyNetN];
+    player.PlHx = Sint16((MAP_SIZE / 2 << CELL_SHIFT) + (1 << CELL_SHIFT) / 2);
+    player.PlHy = player.PlHx;
+
+    CSPBIO::ReInitViewConst(WIDTH, HEIGHT);
+    SelectRenderVariants();
+
+    OC::Bitmap target;
+    target.create(WIDTH, HEIGHT);
+
+    const size_t pixelCount = size_t(target.pitch()) * HEIGHT;
+
+    const OC::Double frequency = OC::Double(SDL_GetPerformanceFrequency());
+
+    OC::WorkerPool& pool = OC::WorkerPool::instance();
+    const int poolThreads = pool.threadCount();
+
+    SDL_Log("Scene rendering benchmark, %ix%i, %i CPU cores", WIDTH, HEIGHT, SDL_GetCPUCount());
+
+    static const char* const PASS_NAMES[] = { "indoor", "glass", "outdoor" };
+
+    // Glass pass makes walls of one texture translucent, outdoor pass measures sky drawn instead of ceiling
+    for (size_t pass = 0; pass < SDL_arraysize(PASS_NAMES); ++pass)
+    {
+        if (1 == pass)
+        {
+            CSPBIO::WallMask[TEXTURE_COUNT - 1] &= ~1;
+        }
+        else if (2 == pass)
+        {
+            CSPBIO::SkyPtr.create(SKY_WIDTH, SKY_HEIGHT, OC::Bitmap::SCOPE_LEVEL);
+
+            for (int y = 0; y < SKY_HEIGHT; ++y)
+            {
+                for (int x = 0; x < SKY_WIDTH; ++x)
+                {
+                    CSPBIO::SkyPtr.setPixel(Uint16(x), Uint16(y), Uint8(rand()));
+                }
+            }
+        }
+
+        SDL_Log("  %s", PASS_NAMES[pass]);
+
+        std::vector<Uint8> reference;
+        OC::Double singleThreadTime = 0.0;
+
+        for (size_t t = 0; t < SDL_arraysize(THREAD_COUNTS); ++t)
+        {
+            const int threads = THREAD_COUNTS[t];
+
+            pool.setThreadCount(threads);
+
+            // Result must not depend on number of threads
+            CSPBIO::Sim.HFi = 0x1234;
+            Scene.render(target);
+
+            if (reference.empty())
+            {
+                reference.assign(target.pixels(), target.pixels() + pixelCount);
+            }
+            else if (0 != SDL_memcmp(&reference[0], target.pixels(), pixelCount))
+            {
+                OC::DoHalt(OC::Format("Scene rendered with %1% threads differs from single threaded one.") % threads);
+            }
+
+            const Uint64 start = SDL_GetPerformanceCounter();
+            Uint64 now = start;
+            int frames = 0;
+
+            do
+            {
+                // Camera turns around, so all directions are measured
+                CSPBIO::Sim.HFi = Uint16(frames * 0x200);
+                Scene.render(target);
+
+                ++frames;
+                now = SDL_GetPerformanceCounter();
+            }
+            while ((now - start) / frequency < MEASURE_TIME);
+
+            const OC::Double seconds = (now - start) / frequency / frames;
+
+            if (1 == threads)
+            {
+                singleThreadTime = seconds;
+            }
+
+            SDL_Log("  %2i threads %8.3f ms %5.2fx", threads, seconds * 1000.0, singleThreadTime / seconds);
+        }
+    }
+
+    pool.setThreadCount(poolThreads);
+
+    target.release();
+    csact::ReleaseLevel();
 }
 
 void SwitchToNextWeapon(/*...*/);
@@ -226,6 +1203,85 @@ void ShowIntro1(/*...*/);
 namespace
 {
 
+// Set by -bench, runs performance measurements instead of the game
+bool Benchmark = false;
+
+// Set by -frames:N, quits after given number of presented frames
+Uint32 FrameLimit = 0;
+
+// Set by -memdump, saves memory statistics on exit
+bool MemoryDump = false;
+
+// Set by -vmode:WIDTHxHEIGHT
+int VideoWidth  = 640;
+int VideoHeight = 480;
+
+// Set by -governor:MILLISECONDS
+OC::Double QualityTarget = 0.0;
+
+// Screen update period during animations in idle mode, 70 Hz as VGA refresh
+const Uint32 IDLE_FRAME_TIME = 1000 / 70;
+
+// Menu or pause, nothing moves unless player does something
+bool IsIdle()
+{
+    return (CSPBIO::Config.MenuOn || CSPBIO::Sim.Paused)
+        && OC::Renderer::BACKEND_HEADLESS != OC::Renderer::instance().backend();
+}
+
+// Milliseconds to wait for events before the next screen update in idle mode,
+// negative value if nothing animates, so waiting is not limited
+int IdleTimeout()
+{
+    const OC::Renderer& renderer = OC::Renderer::instance();
+    const CSPBIO::TConfigState& config = CSPBIO::Config;
+
+    // Console slides and blinks its cursor while open, menu changes on input only
+    if (renderer.isFading() || config.Console || 0 != config.ConsDY)
+    {
+        return int(IDLE_FRAME_TIME);
+    }
+
+    return renderer.hasChanges() ? 0 : -1;
+}
+
+bool GetEvent(SDL_Event& event, const bool idle)
+{
+    if (!idle)
+    {
+        return 1 == SDL_PollEvent(&event);
+    }
+
+    const int timeout = IdleTimeout();
+
+    return 1 == (timeout < 0 ? SDL_WaitEvent(&event) : SDL_WaitEventTimeout(&event, timeout));
+}
+
+// Window and video subsystem are not available in headless mode,
+// so this option is checked before SDL initialization
+bool IsHeadless(const int argc, const char* const* const argv)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        if (0 == SDL_strcasecmp(argv[i], "-headless"))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void RunBenchmarks()
+{
+    OC::BenchmarkPixelKernels();
+    OC::BenchmarkCoverage();
+    Chasm::BenchmarkWalls();
+    Chasm::BenchmarkFloors();
+    Chasm::BenchmarkScene();
+    csact::BenchmarkVisibility();
+}
+
 void ParseCommandLine(const int argc, const char* const* const argv)
 {
     for (int i = 1; i < argc; ++i)
@@ -235,15 +1291,15 @@ void ParseCommandLine(const int argc, const char* const* const argv)
 
         if ("-safe" == parameter)
         {
-            CSPBIO::SafeLoad = true;
+            CSPBIO::Config.SafeLoad = true;
         }
         else if ("-nomonsters" == parameter)
         {
-            CSPBIO::Monsters = false;
+            CSPBIO::Config.Monsters = false;
         }
         else if ("-chojin" == parameter)
         {
-            CSPBIO::Chojin = false;
+            CSPBIO::Config.Chojin = false;
         }
         else if ("-nodemo" == parameter)
         {
@@ -258,9 +1314,16 @@ void ParseCommandLine(const int argc, const char* const* const argv)
             const OC::String path = parameter.substr(sizeof "-addon:" - 1);
             OC::FileSystem::instance().setAddonPath(path);
         }
-        else if ("-vmode" == parameter)
+        else if (boost::algorithm::starts_with(parameter, "-vmode:"))
         {
-            // TODO: video mode
+            int width, height;
+
+            if (2 == SDL_sscanf(parameter.c_str() + sizeof "-vmode:" - 1, "%dx%d", &width, &height)
+                && width > 0 && height > 0)
+            {
+                VideoWidth  = width;
+                VideoHeight = height;
+            }
         }
         else if ("-kalirate" == parameter)
         {
@@ -276,7 +1339,7 @@ void ParseCommandLine(const int argc, const char* const* const argv)
             }
 
             CSPBIO::PlayDemo = 0;
-            CSPBIO::MenuMode = 4;
+            CSPBIO::Config.MenuMode = 4;
         }
         else if (boost::algorithm::starts_with(parameter, "-skill"))
         {
@@ -284,7 +1347,7 @@ void ParseCommandLine(const int argc, const char* const* const argv)
 
             if (skill >= 0 && skill <= 2)
             {
-                CSPBIO::Skill = Sint16(skill);
+                CSPBIO::Config.Skill = Sint16(skill);
             }
         }
         else if (boost::algorithm::starts_with(parameter, "-color"))
@@ -293,12 +1356,12 @@ void ParseCommandLine(const int argc, const char* const* const argv)
 
             if (color > 0 && color <= 8)
             {
-                CSPBIO::SelfColor = Uint8(color);
+                CSPBIO::Config.SelfColor = Uint8(color);
             }
         }
         else if ("-nojoy" == parameter)
         {
-            CSPBIO::JoyStick = false;
+            CSPBIO::Config.JoyStick = false;
         }
         else if ("-nosound" == parameter)
         {
@@ -306,7 +1369,65 @@ void ParseCommandLine(const int argc, const char* const* const argv)
         }
         else if ("-nomouse" == parameter)
         {
-            CSPBIO::MouseD = false;
+            CSPBIO::Config.MouseD = false;
+        }
+        else if ("-bench" == parameter)
+        {
+            Benchmark = true;
+        }
+        else if ("-memdump" == parameter)
+        {
+            MemoryDump = true;
+        }
+        else if (boost::algorithm::starts_with(parameter, "-dumpframes:"))
+        {
+            const int interval = SDL_atoi(parameter.c_str() + sizeof "-dumpframes:" - 1);
+
+            if (interval > 0)
+            {
+                OC::Renderer::instance().setFrameDumpInterval(Uint32(interval));
+            }
+        }
+        else if (boost::algorithm::starts_with(parameter, "-scale:"))
+        {
+            const int scale = SDL_atoi(parameter.c_str() + sizeof "-scale:" - 1);
+            OC::Renderer::instance().setWindowScale(scale);
+        }
+        else if ("-epx" == parameter)
+        {
+            OC::Renderer::instance().setScaleFilter(OC::SCALE_EPX);
+        }
+        else if (boost::algorithm::starts_with(parameter, "-governor:"))
+        {
+            const double target = SDL_atof(parameter.c_str() + sizeof "-governor:" - 1);
+
+            if (target > 0.0)
+            {
+                QualityTarget = target;
+            }
+        }
+        else if (boost::algorithm::starts_with(parameter, "-threads:"))
+        {
+            const int threads = SDL_atoi(parameter.c_str() + sizeof "-threads:" - 1);
+            OC::WorkerPool::instance().setThreadCount(threads);
+        }
+        else if (boost::algorithm::starts_with(parameter, "-maxentities:"))
+        {
+            const int limit = SDL_atoi(parameter.c_str() + sizeof "-maxentities:" - 1);
+
+            if (limit > 0)
+            {
+                CSPBIO::SetEntityLimit(size_t(limit));
+            }
+        }
+        else if (boost::algorithm::starts_with(parameter, "-frames:"))
+        {
+            const int frames = SDL_atoi(parameter.c_str() + sizeof "-frames:" - 1);
+
+            if (frames > 0)
+            {
+                FrameLimit = Uint32(frames);
+            }
         }
     }
 }
@@ -316,7 +1437,9 @@ void ParseCommandLine(const int argc, const char* const* const argv)
 
 int main(int argc, char** argv)
 {
-    if (0 != SDL_Init(SDL_INIT_EVERYTHING))
+    const bool headless = IsHeadless(argc, argv);
+
+    if (0 != SDL_Init(headless ? SDL_INIT_TIMER | SDL_INIT_EVENTS : SDL_INIT_EVERYTHING))
     {
         OC::DoHaltSDLError("Failed to initialize SDL.");
         return EXIT_FAILURE;
@@ -327,6 +1450,12 @@ int main(int argc, char** argv)
     OC::FileSystem::initialize();
     OC::BitmapManager::initialize();
     OC::Renderer::initialize();
+    OC::WorkerPool::initialize();
+
+    if (headless)
+    {
+        OC::Renderer::instance().setBackend(OC::Renderer::BACKEND_HEADLESS);
+    }
 
     SoundIP::InitModule();
     CSPBIO::InitModule();
@@ -356,14 +1485,26 @@ int main(int argc, char** argv)
 
     Chasm::LoadConfig(true);
 
-    CSPBIO::Players[0].PName  = CSPBIO::SelfNick;
-    CSPBIO::Players[0].PColor = CSPBIO::SelfColor;
+    CSPBIO::Players[0].PName  = CSPBIO::Config.SelfNick;
+    CSPBIO::Players[0].PColor = CSPBIO::Config.SelfColor;
 
     CSPUTL::InitMessageSystem();
 
     ParseCommandLine(argc, argv);
 
-    if (CSPBIO::SafeLoad)
+    if (Benchmark)
+    {
+        RunBenchmarks();
+
+        OC::WorkerPool::shutdown();
+        OC::Renderer::shutdown();
+        OC::BitmapManager::shutdown();
+        OC::FileSystem::shutdown();
+
+        return EXIT_SUCCESS;
+    }
+
+    if (CSPBIO::Config.SafeLoad)
     {
         // TODO: safe mode
     }
@@ -383,12 +1524,13 @@ int main(int argc, char** argv)
 
     CSPBIO::LoadGraphics();
 
-    // TODO: csact::ReleaseLevel();
+    csact::ReleaseLevel();
+
+    CSPBIO::SetVideoMode(Uint16(std::min(VideoWidth, 0xFFFF)), Uint16(std::min(VideoHeight, 0xFFFF)));
 
-    // TODO: video modes support
-    OC::Renderer::instance().setVideoMode(640, 480);
+    Chasm::SelectRenderVariants();
 
-    CSPBIO::ReDrawGround();
+    Chasm::SetQualityTarget(QualityTarget);
 
     Chasm::ReInitOwners();
 
@@ -401,14 +1543,17 @@ int main(int argc, char** argv)
 
     // TODO: init joystick
 
+    const Uint32 startTicks = SDL_GetTicks();
+    const OC::Double counterFrequency = OC::Double(SDL_GetPerformanceFrequency());
+
     for (;;)
     {
-        switch (CSPBIO::MenuCode)
+        switch (CSPBIO::Config.MenuCode)
         {
             case 4:
                 csact::LoadLevel();
 
-                CSPBIO::MenuCode = 1;
+                CSPBIO::Config.MenuCode = 1;
                 break;
                 
             default:
@@ -416,18 +1561,61 @@ int main(int argc, char** argv)
                 break;
         }
 
+        csact::UpdateVisibility();
+
+        // Idle loop sleeps in event waiting, so CPU isn't used while nothing changes
+        const bool idle = IsIdle();
+
         SDL_Event e;
+        const bool hasEvent = GetEvent(e, idle);
+
+        // Governor measures work done for a frame, waiting for events or level loading is not included
+        const Uint64 frameStart = SDL_GetPerformanceCounter();
 
-        if (1 == SDL_PollEvent(&e) && SDL_QUIT == e.type)
+        if (hasEvent && SDL_QUIT == e.type)
         {
             break;
         }
         else
         {
-            OC::Renderer::instance().present();
+            // Only changed screen areas are presented, so damaged window needs full update
+            if (hasEvent && SDL_WINDOWEVENT == e.type
+                && (SDL_WINDOWEVENT_EXPOSED == e.window.event || SDL_WINDOWEVENT_SIZE_CHANGED == e.window.event))
+            {
+                OC::Renderer::instance().invalidate();
+            }
+
+            if (hasEvent)
+            {
+                Chasm::ProcessConsole(e);
+            }
+
+            Chasm::EndPaint();
+
+            // Idle frames say nothing about rendering cost
+            if (!idle)
+            {
+                Chasm::UpdateQuality((SDL_GetPerformanceCounter() - frameStart) * 1000.0 / counterFrequency);
+            }
+        }
+
+        if (0 != FrameLimit && OC::Renderer::instance().frameCount() >= FrameLimit)
+        {
+            const Uint32 elapsed = SDL_GetTicks() - startTicks;
+
+            SDL_Log("%u frames in %u ms, %.2f FPS", FrameLimit, elapsed,
+                FrameLimit * 1000.0 / std::max(elapsed, Uint32(1)));
+
+            break;
         }
     }
 
+    if (MemoryDump)
+    {
+        Chasm::ExecConsole("memdump");
+    }
+
+    OC::WorkerPool::shutdown();
     OC::Renderer::shutdown();
     OC::BitmapManager::shutdown();
     OC::FileSystem::shutdown();